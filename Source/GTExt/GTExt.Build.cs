@@ -28,6 +28,7 @@ public class GTExt : ModuleRules
                 "Niagara",
                 "AIModule",
                 "NetCore",
+                "ReplicationGraph",
             }
         );
 
@@ -38,5 +39,7 @@ public class GTExt : ModuleRules
                 "GFCore",
             }
         );
+
+        SetupIrisSupport(Target);
     }
 }
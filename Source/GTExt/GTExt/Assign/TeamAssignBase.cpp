@@ -5,10 +5,11 @@
 #include "TeamFunctionLibrary.h"
 #include "TeamCreationData.h"
 #include "TeamMemberComponent.h"
+#include "TeamManagerSubsystem.h"
+#include "TeamPopulationHeap.h"
 
 #include "GameFramework/GameStateBase.h"
 #include "GameFramework/PlayerState.h"
-#include "Kismet/GameplayStatics.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(TeamAssignBase)
 
@@ -33,6 +34,11 @@ void UTeamAssignBase::AssignTeamForPlayer(const UTeamCreationData* TeamCreationD
 	ProcessAssign(TeamCreationData, PlayerState, GameState);
 }
 
+void UTeamAssignBase::AssignTeamsForPlayers(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const
+{
+	ProcessAssignBatch(TeamCreationData, PlayerStates, GameState);
+}
+
 
 void UTeamAssignBase::ProcessAssign(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const
 {
@@ -45,47 +51,20 @@ void UTeamAssignBase::ProcessAssign(const UTeamCreationData* TeamCreationData, A
 	const auto& TeamsToCreate{ TeamCreationData->TeamsToCreate };
 	const auto NumTeams{ TeamsToCreate.Num() };
 
-	if (NumTeams > 0)
-	{
-		// Create a map to count the number of players on a team
-		
-		TMap<int32, uint32> TeamMemberCounts;
-		TeamMemberCounts.Reserve(NumTeams);
-
-		for (const auto& KVP : TeamsToCreate)
-		{
-			TeamMemberCounts.Add(KVP.Key, 0);
-		}
-
-		// Count the number of players on the team
-
-		for (const auto& PS : GameState->PlayerArray)
-		{
-			if (auto* OtherTMC{ UTeamFunctionLibrary::GetTeamMemberComponentFromActor(PS) })
-			{
-				const auto PlayerTeamID{ OtherTMC->GetGenericTeamId().GetId() };
-
-				// do not count unassigned or disconnected players
-
-				if (!PS->IsInactive())	
-				{
-					if (TeamMemberCounts.Contains(PlayerTeamID))
-					{
-						TeamMemberCounts[PlayerTeamID] += 1;
-					}
-				}
-			}
-		}
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
 
+	if ((NumTeams > 0) && ensure(TMS))
+	{
 		// Sort by lowest team population, then by team ID
+		// Team populations are tracked by the subsystem so unassigned or disconnected players are already excluded
 
 		auto BestTeamId{ static_cast<int32>(INDEX_NONE) };
 		auto BestPlayerCount{ TNumericLimits<uint32>::Max() };
 
-		for (const auto& KVP : TeamMemberCounts)
+		for (const auto& KVP : TeamsToCreate)
 		{
-			const auto& TestTeamId{ KVP.Key };
-			const auto& TestTeamPlayerCount{ KVP.Value };
+			const auto TestTeamId{ static_cast<int32>(KVP.Key) };
+			const auto TestTeamPlayerCount{ static_cast<uint32>(TMS->GetActiveMemberCountOfTeam(TestTeamId)) };
 
 			if (TestTeamPlayerCount < BestPlayerCount)
 			{
@@ -110,6 +89,118 @@ void UTeamAssignBase::ProcessAssign(const UTeamCreationData* TeamCreationData, A
 	}
 }
 
+void UTeamAssignBase::ProcessAssignBatch(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const
+{
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
+	if (!ensure(TMS))
+	{
+		return;
+	}
+
+	// Assignments derived in native code may choose teams in their own way, so each player goes through ProcessAssign
+
+	if (!IsBuiltInAssign(UTeamAssignBase::StaticClass()))
+	{
+		for (auto* PlayerState : PlayerStates)
+		{
+			if (PlayerState->IsOnlyASpectator())
+			{
+				if (auto* TMC{ TMS->FindTeamMemberComponent(PlayerState) })
+				{
+					TMC->SetGenericTeamId(FGenericTeamId::NoTeam);
+				}
+			}
+			else
+			{
+				AssignTeamForPlayer(TeamCreationData, PlayerState, GameState);
+			}
+		}
+
+		return;
+	}
+
+	TArray<APlayerState*> PendingPlayers;
+	TArray<UTeamMemberComponent*> PendingMembers;
+	AssignSpectatorsAndOptionPlayers(TeamCreationData, PlayerStates, GameState, PendingPlayers, PendingMembers);
+
+	if (PendingMembers.IsEmpty())
+	{
+		return;
+	}
+
+	// Build a heap of the current team populations
+
+	FTeamPopulationHeap Heap;
+
+	for (const auto& KVP : TeamCreationData->TeamsToCreate)
+	{
+		const auto TeamId{ static_cast<int32>(KVP.Key) };
+		Heap.Add(TeamId, TMS->GetActiveMemberCountOfTeam(TeamId));
+	}
+
+	// Assign players in order so that the result is the same as assigning them one by one
+
+	for (auto* TMC : PendingMembers)
+	{
+		const auto OldTeamId{ TMC->GetTeamId() };
+
+		TMC->SetGenericTeamId(UTeamFunctionLibrary::IntegerToGenericTeamId(Heap.GetTopTeamId()));
+
+		// Populations are tracked by the subsystem, so refresh only the teams that may have changed
+
+		const auto NewTeamId{ TMC->GetTeamId() };
+		if (OldTeamId != NewTeamId)
+		{
+			Heap.Update(OldTeamId, TMS->GetActiveMemberCountOfTeam(OldTeamId));
+			Heap.Update(NewTeamId, TMS->GetActiveMemberCountOfTeam(NewTeamId));
+		}
+	}
+}
+
+void UTeamAssignBase::AssignSpectatorsAndOptionPlayers(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState
+	, TArray<APlayerState*>& OutPendingPlayers, TArray<UTeamMemberComponent*>& OutPendingMembers) const
+{
+	OutPendingPlayers.Reset(PlayerStates.Num());
+	OutPendingMembers.Reset(PlayerStates.Num());
+
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
+	if (!ensure(TMS))
+	{
+		return;
+	}
+
+	for (auto* PlayerState : PlayerStates)
+	{
+		auto* TMC{ TMS->FindTeamMemberComponent(PlayerState) };
+		if (!ensure(TMC))
+		{
+			continue;
+		}
+
+		if (PlayerState->IsOnlyASpectator())
+		{
+			TMC->SetGenericTeamId(FGenericTeamId::NoTeam);
+		}
+		else if (!ProcessAssignFromGameModeOption(TeamCreationData, PlayerState, GameState))
+		{
+			OutPendingPlayers.Add(PlayerState);
+			OutPendingMembers.Add(TMC);
+		}
+	}
+}
+
+bool UTeamAssignBase::IsBuiltInAssign(const UClass* BuiltInClass) const
+{
+	auto* NativeClass{ GetClass() };
+
+	while (NativeClass && !NativeClass->HasAnyClassFlags(CLASS_Native))
+	{
+		NativeClass = NativeClass->GetSuperClass();
+	}
+
+	return NativeClass == BuiltInClass;
+}
+
 bool UTeamAssignBase::ProcessAssignFromGameModeOption(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const
 {
 	/**
@@ -117,19 +208,17 @@ bool UTeamAssignBase::ProcessAssignFromGameModeOption(const UTeamCreationData* T
 	 */
 
 	auto GM{ GameState->AuthorityGameMode };
-	if (GM && PlayerState)
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
+
+	if (GM && TMS && PlayerState)
 	{
-		const auto OptionsString{ GM->OptionsString };
-		const auto OptionKey{ FString::Printf(TEXT("TM[%s]"), *PlayerState->GetPlayerName())};
+		const auto& OptionIndex{ TMS->GetGameModeOptionIndex(GM) };
 
-		if (UGameplayStatics::HasOption(OptionsString, OptionKey))
+		if (const auto* TeamId{ OptionIndex.FindMemberTeamId(PlayerState) })
 		{
-			const auto StringValue{ UGameplayStatics::ParseOption(OptionsString, OptionKey) };
-			const auto TeamId{ FCString::Atoi(*StringValue) };
-
-			if (auto* TeamMember{ UTeamFunctionLibrary::GetTeamMemberComponentFromActor(PlayerState) })
+			if (auto* TeamMember{ TMS->FindTeamMemberComponent(PlayerState) })
 			{
-				TeamMember->SetGenericTeamId(UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId));
+				TeamMember->SetGenericTeamId(UTeamFunctionLibrary::IntegerToGenericTeamId(*TeamId));
 
 				return true;
 			}
@@ -140,6 +229,105 @@ bool UTeamAssignBase::ProcessAssignFromGameModeOption(const UTeamCreationData* T
 }
 
 
+void UTeamAssignBase::ComputeRebalanceMoves(const UTeamCreationData* TeamCreationData, const UTeamManagerSubsystem* TMS, int32 Tolerance, TArray<FTeamRebalanceMove>& OutMoves) const
+{
+	OutMoves.Reset();
+
+	if (!ensure(TMS) || TeamCreationData->TeamsToCreate.Num() < 2)
+	{
+		return;
+	}
+
+	Tolerance = FMath::Max(Tolerance, 1);
+
+	// Current populations from the rosters, in order of team ID
+
+	TArray<int32> TeamIds;
+	TArray<int32> TeamCounts;
+
+	for (const auto& KVP : TeamCreationData->TeamsToCreate)
+	{
+		TeamIds.Add(static_cast<int32>(KVP.Key));
+	}
+
+	TeamIds.Sort();
+
+	for (const auto& TeamId : TeamIds)
+	{
+		TeamCounts.Add(TMS->GetActiveMemberCountOfTeam(TeamId));
+	}
+
+	// Each move takes one player from the largest team to the smallest, which is the fewest moves possible
+
+	TSet<const APlayerState*> MovedPlayers;
+
+	while (true)
+	{
+		auto LargestIndex{ 0 };
+		auto SmallestIndex{ 0 };
+
+		for (auto Index{ 1 }; Index < TeamIds.Num(); ++Index)
+		{
+			if (TeamCounts[Index] > TeamCounts[LargestIndex])
+			{
+				LargestIndex = Index;
+			}
+
+			if (TeamCounts[Index] < TeamCounts[SmallestIndex])
+			{
+				SmallestIndex = Index;
+			}
+		}
+
+		if (TeamCounts[LargestIndex] - TeamCounts[SmallestIndex] <= Tolerance)
+		{
+			break;
+		}
+
+		// Choose the player of the largest team with the highest priority
+
+		APlayerState* BestPlayer{ nullptr };
+		auto BestPriority{ TNumericLimits<int64>::Lowest() };
+
+		TMS->ForEachMemberOfTeam(TeamIds[LargestIndex], [this, &MovedPlayers, &BestPlayer, &BestPriority](const UTeamMemberComponent* Member)
+		{
+			auto* PlayerState{ Cast<APlayerState>(Member->GetOwner()) };
+
+			if (PlayerState && Member->IsActiveTeamMember() && !PlayerState->IsOnlyASpectator() && !MovedPlayers.Contains(PlayerState))
+			{
+				const auto Priority{ GetRebalanceMovePriority(PlayerState) };
+
+				if (!BestPlayer || (Priority > BestPriority))
+				{
+					BestPlayer = PlayerState;
+					BestPriority = Priority;
+				}
+			}
+		});
+
+		if (!BestPlayer)
+		{
+			break;
+		}
+
+		MovedPlayers.Add(BestPlayer);
+		OutMoves.Emplace(BestPlayer, TeamIds[LargestIndex], TeamIds[SmallestIndex]);
+
+		TeamCounts[LargestIndex]--;
+		TeamCounts[SmallestIndex]++;
+	}
+}
+
+int64 UTeamAssignBase::GetRebalanceMovePriority(const APlayerState* PlayerState) const
+{
+	// Players without a pawn (e.g., dead) first, then the players who joined most recently
+
+	const auto bHasPawn{ PlayerState->GetPawn() != nullptr };
+
+	return (bHasPawn ? 0ll : (1ll << 32)) + static_cast<int64>(PlayerState->StartTime);
+}
+
+
 FString UTeamAssignBase::ConstructGameModeOption(const TArray<APlayerState*>& Players) const
 {
 	/**
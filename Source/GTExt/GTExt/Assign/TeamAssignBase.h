@@ -5,10 +5,39 @@
 #include "TeamAssignBase.generated.h"
 
 class UTeamCreationData;
+class UTeamManagerSubsystem;
+class UTeamMemberComponent;
 class APlayerState;
 class AGameState;
 
 
+/**
+ * Player to be moved to another team to rebalance team populations
+ */
+USTRUCT(BlueprintType)
+struct FTeamRebalanceMove
+{
+	GENERATED_BODY()
+public:
+	FTeamRebalanceMove() {}
+
+	FTeamRebalanceMove(APlayerState* InPlayerState, int32 InFromTeamId, int32 InToTeamId)
+		: PlayerState(InPlayerState), FromTeamId(InFromTeamId), ToTeamId(InToTeamId)
+	{}
+
+public:
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<APlayerState> PlayerState{ nullptr };
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 FromTeamId{ INDEX_NONE };
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 ToTeamId{ INDEX_NONE };
+
+};
+
+
 /**
  * Base class that defines and executes the method of automatic team assignment
  */
@@ -25,10 +54,60 @@ public:
 	 */
 	void AssignTeamForPlayer(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const;
 
+	/**
+	 * Assign teams for multiple players at once
+	 * 
+	 * Tips:
+	 *	Players with a team in the game mode option are assigned first, the others as if by AssignTeamForPlayer in order.
+	 *	Spectator-only player states will be stripped of any team association.
+	 */
+	void AssignTeamsForPlayers(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const;
+
 protected:
 	virtual void ProcessAssign(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const;
 	virtual bool ProcessAssignFromGameModeOption(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const;
 
+	/**
+	 * Assign teams for multiple players in one pass
+	 * 
+	 * Tips:
+	 *	By default, ProcessAssign is called for each player.
+	 *	Built-in assignments whose ProcessAssign is not overridden in native code use a faster path instead,
+	 *	e.g., this class keeps team populations in a min-heap so each player costs O(log team count)
+	 */
+	virtual void ProcessAssignBatch(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const;
+
+	/**
+	 * Strip spectators of their team and assign the players that have a team in the game mode option
+	 * 
+	 * Tips:
+	 *	The remaining players and their team member components are added to the out arrays in the same order
+	 */
+	void AssignSpectatorsAndOptionPlayers(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState
+		, TArray<APlayerState*>& OutPendingPlayers, TArray<UTeamMemberComponent*>& OutPendingMembers) const;
+
+	/**
+	 * Returns whether the closest native class of this object is the built-in class, so its batch path matches ProcessAssign
+	 */
+	bool IsBuiltInAssign(const UClass* BuiltInClass) const;
+
+
+public:
+	/**
+	 * Computes the fewest moves that bring the difference between the largest and smallest team within the tolerance
+	 * 
+	 * Tips:
+	 *	Computed from the team rosters of the subsystem without scanning the player array.
+	 *	Players without a pawn are moved first, then the players who joined most recently
+	 */
+	virtual void ComputeRebalanceMoves(const UTeamCreationData* TeamCreationData, const UTeamManagerSubsystem* TMS, int32 Tolerance, TArray<FTeamRebalanceMove>& OutMoves) const;
+
+protected:
+	/**
+	 * Returns the priority of the player to be moved by rebalancing, higher is moved first
+	 */
+	virtual int64 GetRebalanceMovePriority(const APlayerState* PlayerState) const;
+
 
 public:
 	virtual FString ConstructGameModeOption(const TArray<APlayerState*>& Players) const;
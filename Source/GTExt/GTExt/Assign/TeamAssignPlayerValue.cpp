@@ -0,0 +1,105 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamAssignPlayerValue.h"
+
+#include "GameplayTag/GameplayTagStackInterface.h"
+
+#include "GameFramework/PlayerState.h"
+#include "UObject/UnrealType.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamAssignPlayerValue)
+
+
+double FTeamAssignPlayerValue::GetValue(const APlayerState* PlayerState) const
+{
+	if (!PlayerState)
+	{
+		return DefaultValue;
+	}
+
+	if (Source == ETeamAssignPlayerValueSource::TagStack)
+	{
+		const auto* Interface{ Cast<IGameplayTagStackInterface>(PlayerState) };
+		const auto* Stacks{ Interface ? Interface->GetStatTagsConst() : nullptr };
+
+		const auto* Stack{ Stacks ? Stacks->FastStacks.Find(StackTag) : nullptr };
+
+		return Stack ? static_cast<double>(Stack->StackCount) : DefaultValue;
+	}
+
+	const auto* Property{ CastField<FNumericProperty>(FindProperty(PlayerState)) };
+	if (!Property)
+	{
+		return DefaultValue;
+	}
+
+	const auto* ValuePtr{ Property->ContainerPtrToValuePtr<void>(PlayerState) };
+
+	return Property->IsFloatingPoint() ? Property->GetFloatingPointPropertyValue(ValuePtr) : static_cast<double>(Property->GetSignedIntPropertyValue(ValuePtr));
+}
+
+FString FTeamAssignPlayerValue::GetKey(const APlayerState* PlayerState) const
+{
+	if (!PlayerState)
+	{
+		return FString();
+	}
+
+	if (Source == ETeamAssignPlayerValueSource::TagStack)
+	{
+		const auto* Interface{ Cast<IGameplayTagStackInterface>(PlayerState) };
+		const auto* Stacks{ Interface ? Interface->GetStatTagsConst() : nullptr };
+
+		const auto* Stack{ Stacks ? Stacks->FastStacks.Find(StackTag) : nullptr };
+
+		return Stack ? LexToString(Stack->StackCount) : FString();
+	}
+
+	const auto* Property{ FindProperty(PlayerState) };
+	if (!Property)
+	{
+		return FString();
+	}
+
+	const auto* ValuePtr{ Property->ContainerPtrToValuePtr<void>(PlayerState) };
+
+	if (const auto* StrProperty{ CastField<FStrProperty>(Property) })
+	{
+		return StrProperty->GetPropertyValue(ValuePtr);
+	}
+
+	if (const auto* NameProperty{ CastField<FNameProperty>(Property) })
+	{
+		const auto Name{ NameProperty->GetPropertyValue(ValuePtr) };
+		return Name.IsNone() ? FString() : Name.ToString();
+	}
+
+	// Integers are converted without going through a double so that 64-bit IDs stay exact
+
+	if (const auto* NumericProperty{ CastField<FNumericProperty>(Property) }; NumericProperty && NumericProperty->IsInteger())
+	{
+		return LexToString(NumericProperty->GetSignedIntPropertyValue(ValuePtr));
+	}
+
+	// Anything else (e.g., FGuid) is keyed by its exported text
+
+	FString Key;
+	Property->ExportTextItem_Direct(Key, ValuePtr, nullptr, nullptr, PPF_None);
+
+	return Key;
+}
+
+FProperty* FTeamAssignPlayerValue::FindProperty(const APlayerState* PlayerState) const
+{
+	// Resolve the property once per player state class
+
+	const auto* Class{ PlayerState->GetClass() };
+
+	if (CachedClass.Get() != Class)
+	{
+		CachedClass = Class;
+		CachedProperty = FindFProperty<FProperty>(Class, PropertyName);
+	}
+
+	return CachedProperty;
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameplayTagContainer.h"
+
+#include "TeamAssignPlayerValue.generated.h"
+
+class APlayerState;
+class UClass;
+class FProperty;
+
+
+/**
+ * Where the value of a player used for team assignment is read from
+ */
+UENUM(BlueprintType)
+enum class ETeamAssignPlayerValueSource : uint8
+{
+	TagStack,	// Stack count of a tag on a player state implementing IGameplayTagStackInterface
+
+	Property	// Numeric property of the player state
+};
+
+
+/**
+ * Configurable source of a per-player value used by team assignment, such as a skill rating or a party ID
+ */
+USTRUCT(BlueprintType)
+struct GTEXT_API FTeamAssignPlayerValue
+{
+	GENERATED_BODY()
+public:
+	FTeamAssignPlayerValue() {}
+
+public:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	ETeamAssignPlayerValueSource Source{ ETeamAssignPlayerValueSource::TagStack };
+
+	//
+	// Tag whose stack count is used as the value
+	//
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (EditCondition = "Source == ETeamAssignPlayerValueSource::TagStack", EditConditionHides))
+	FGameplayTag StackTag;
+
+	//
+	// Name of the property of the player state used as the value
+	// (numeric for GetValue, any type for GetKey)
+	//
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (EditCondition = "Source == ETeamAssignPlayerValueSource::Property", EditConditionHides))
+	FName PropertyName{ NAME_None };
+
+	//
+	// Value used when the player state does not provide one
+	//
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	double DefaultValue{ 0.0 };
+
+protected:
+	//
+	// Last resolved property, cached so that reading many players of the same class does not search the class each time
+	//
+	mutable TWeakObjectPtr<const UClass> CachedClass;
+	mutable FProperty* CachedProperty{ nullptr };
+
+	FProperty* FindProperty(const APlayerState* PlayerState) const;
+
+public:
+	/**
+	 * Returns the value of the player or DefaultValue if the player does not provide one
+	 */
+	double GetValue(const APlayerState* PlayerState) const;
+
+	/**
+	 * Returns the value of the player as an exact string key, or an empty string if the player does not provide one
+	 * 
+	 * Tips:
+	 *	Use this for identifiers such as party IDs, which may be strings, names, GUIDs or 64-bit integers
+	 */
+	FString GetKey(const APlayerState* PlayerState) const;
+
+};
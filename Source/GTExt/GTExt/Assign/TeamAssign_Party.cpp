@@ -0,0 +1,270 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamAssign_Party.h"
+
+#include "TeamFunctionLibrary.h"
+#include "TeamCreationData.h"
+#include "TeamMemberComponent.h"
+#include "TeamManagerSubsystem.h"
+
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamAssign_Party)
+
+
+UTeamAssign_Party::UTeamAssign_Party(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+
+FString UTeamAssign_Party::GetPartyId(const APlayerState* PlayerState) const
+{
+	// Party IDs from matchmaking are usually strings or GUIDs, so they are compared as string keys instead of numbers
+
+	auto Key{ PartyId.GetKey(PlayerState) };
+
+	if (Key.IsNumeric() && (FCString::Atod(*Key) <= 0.0))
+	{
+		Key.Reset();
+	}
+
+	return Key;
+}
+
+void UTeamAssign_Party::ProcessAssign(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const
+{
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
+	auto* TMC{ TMS ? TMS->FindTeamMemberComponent(PlayerState) : nullptr };
+	if (!ensure(TMC))
+	{
+		return;
+	}
+
+	// Join the team with the most members of the same party, then the team with the lowest ID
+
+	const auto Party{ GetPartyId(PlayerState) };
+	if (!Party.IsEmpty())
+	{
+		auto BestTeamId{ static_cast<int32>(INDEX_NONE) };
+		auto BestPartyCount{ 0 };
+
+		for (const auto& KVP : TeamCreationData->TeamsToCreate)
+		{
+			const auto TeamId{ static_cast<int32>(KVP.Key) };
+			auto PartyCount{ 0 };
+
+			TMS->ForEachMemberOfTeam(TeamId, [this, TMC, &Party, &PartyCount](const UTeamMemberComponent* Member)
+			{
+				if ((Member != TMC) && Member->IsActiveTeamMember() && (GetPartyId(Cast<APlayerState>(Member->GetOwner())) == Party))
+				{
+					PartyCount++;
+				}
+			});
+
+			if ((PartyCount > BestPartyCount) || ((PartyCount == BestPartyCount) && (PartyCount > 0) && (TeamId < BestTeamId)))
+			{
+				BestTeamId = TeamId;
+				BestPartyCount = PartyCount;
+			}
+		}
+
+		if (BestTeamId != INDEX_NONE)
+		{
+			TMC->SetGenericTeamId(UTeamFunctionLibrary::IntegerToGenericTeamId(BestTeamId));
+			return;
+		}
+	}
+
+	// No member of the party is in a team yet, so join the team with the fewest players
+
+	Super::ProcessAssign(TeamCreationData, PlayerState, GameState);
+}
+
+void UTeamAssign_Party::ProcessAssignBatch(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const
+{
+	if (!IsBuiltInAssign(UTeamAssign_Party::StaticClass()))
+	{
+		Super::ProcessAssignBatch(TeamCreationData, PlayerStates, GameState);
+		return;
+	}
+
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
+	if (!ensure(TMS))
+	{
+		return;
+	}
+
+	TArray<APlayerState*> PendingPlayers;
+	TArray<UTeamMemberComponent*> PendingMemberList;
+	AssignSpectatorsAndOptionPlayers(TeamCreationData, PlayerStates, GameState, PendingPlayers, PendingMemberList);
+
+	// Group players without a team from the game mode option by party, in the order the parties first appear
+
+	TArray<TArray<UTeamMemberComponent*, TInlineAllocator<4>>> Groups;
+	TMap<FString, int32> PartyToGroupIndex;
+	TSet<const UTeamMemberComponent*> PendingMembers;
+	PendingMembers.Reserve(PendingMemberList.Num());
+
+	for (auto Index{ 0 }; Index < PendingPlayers.Num(); ++Index)
+	{
+		auto* TMC{ PendingMemberList[Index] };
+		const auto Party{ GetPartyId(PendingPlayers[Index]) };
+
+		PendingMembers.Add(TMC);
+
+		if (const auto* GroupIndex{ !Party.IsEmpty() ? PartyToGroupIndex.Find(Party) : nullptr })
+		{
+			Groups[*GroupIndex].Add(TMC);
+		}
+		else
+		{
+			const auto NewGroupIndex{ Groups.AddDefaulted() };
+			Groups[NewGroupIndex].Add(TMC);
+
+			if (!Party.IsEmpty())
+			{
+				PartyToGroupIndex.Add(Party, NewGroupIndex);
+			}
+		}
+	}
+
+	if (Groups.IsEmpty())
+	{
+		return;
+	}
+
+	// Count the players already on each team, in order of team ID
+
+	TArray<int32> TeamIds;
+	TArray<int32> TeamCounts;
+
+	for (const auto& KVP : TeamCreationData->TeamsToCreate)
+	{
+		TeamIds.Add(static_cast<int32>(KVP.Key));
+	}
+
+	TeamIds.Sort();
+
+	for (const auto& TeamId : TeamIds)
+	{
+		auto& Count{ TeamCounts.Add_GetRef(0) };
+
+		TMS->ForEachMemberOfTeam(TeamId, [&Count, &PendingMembers](const UTeamMemberComponent* Member)
+		{
+			if (Member->IsActiveTeamMember() && !PendingMembers.Contains(Member))
+			{
+				Count++;
+			}
+		});
+	}
+
+	if (TeamIds.IsEmpty())
+	{
+		for (const auto& Group : Groups)
+		{
+			for (auto* TMC : Group)
+			{
+				TMC->SetGenericTeamId(FGenericTeamId::NoTeam);
+			}
+		}
+
+		return;
+	}
+
+	// Pack the parties into the teams
+
+	TArray<int32> GroupSizes;
+	GroupSizes.Reserve(Groups.Num());
+
+	for (const auto& Group : Groups)
+	{
+		GroupSizes.Add(Group.Num());
+	}
+
+	TArray<int32> TeamIndices;
+	PackGroups(GroupSizes, TeamCounts, TeamIndices);
+
+	for (auto GroupIndex{ 0 }; GroupIndex < Groups.Num(); ++GroupIndex)
+	{
+		const auto NewTeamId{ UTeamFunctionLibrary::IntegerToGenericTeamId(TeamIds[TeamIndices[GroupIndex]]) };
+
+		for (auto* TMC : Groups[GroupIndex])
+		{
+			TMC->SetGenericTeamId(NewTeamId);
+		}
+	}
+}
+
+
+void UTeamAssign_Party::PackGroups(TConstArrayView<int32> GroupSizes, TArray<int32>& TeamCounts, TArray<int32>& OutTeamIndices)
+{
+	const auto NumGroups{ GroupSizes.Num() };
+	const auto NumTeams{ TeamCounts.Num() };
+
+	OutTeamIndices.Init(INDEX_NONE, NumGroups);
+
+	if ((NumGroups <= 0) || (NumTeams <= 0))
+	{
+		return;
+	}
+
+	// Capacity of each team when all players are spread evenly
+
+	auto TotalCount{ 0 };
+	for (const auto& Size : GroupSizes)
+	{
+		TotalCount += Size;
+	}
+	for (const auto& Count : TeamCounts)
+	{
+		TotalCount += Count;
+	}
+
+	const auto Capacity{ FMath::DivideAndRoundUp(TotalCount, NumTeams) };
+
+	// Place the largest groups first, each into the team with the fewest players that still has room for it.
+	// Groups too large for any team go to the team with the fewest players
+
+	TArray<int32, TInlineAllocator<256>> Order;
+	Order.SetNumUninitialized(NumGroups);
+
+	for (auto Index{ 0 }; Index < NumGroups; ++Index)
+	{
+		Order[Index] = Index;
+	}
+
+	Order.Sort([&GroupSizes](int32 A, int32 B)
+	{
+		return (GroupSizes[A] > GroupSizes[B]) || ((GroupSizes[A] == GroupSizes[B]) && (A < B));
+	});
+
+	for (const auto& GroupIndex : Order)
+	{
+		const auto Size{ GroupSizes[GroupIndex] };
+
+		auto BestFitIndex{ static_cast<int32>(INDEX_NONE) };
+		auto SmallestIndex{ 0 };
+
+		for (auto TeamIndex{ 0 }; TeamIndex < NumTeams; ++TeamIndex)
+		{
+			const auto Count{ TeamCounts[TeamIndex] };
+
+			if ((Count + Size <= Capacity) && ((BestFitIndex == INDEX_NONE) || (Count < TeamCounts[BestFitIndex])))
+			{
+				BestFitIndex = TeamIndex;
+			}
+
+			if (Count < TeamCounts[SmallestIndex])
+			{
+				SmallestIndex = TeamIndex;
+			}
+		}
+
+		const auto TeamIndex{ (BestFitIndex != INDEX_NONE) ? BestFitIndex : SmallestIndex };
+
+		TeamCounts[TeamIndex] += Size;
+		OutTeamIndices[GroupIndex] = TeamIndex;
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "TeamAssignBase.h"
+
+#include "TeamAssignPlayerValue.h"
+
+#include "TeamAssign_Party.generated.h"
+
+class UTeamManagerSubsystem;
+
+
+/**
+ * Team assignment that keeps the players of a party on the same team
+ * 
+ * Tips:
+ *	Players assigned together are grouped by party and packed into teams largest party first,
+ *	each party going to the team with the fewest players that still has room for it.
+ *	Players joining later go to the team of their party, or to the team with the fewest players.
+ *	Players with an empty party ID, or a numeric party ID of 0 or below, are treated as solo players
+ */
+UCLASS(meta = (DisplayName = "Party"))
+class GTEXT_API UTeamAssign_Party : public UTeamAssignBase
+{
+	GENERATED_BODY()
+public:
+	UTeamAssign_Party(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+protected:
+	//
+	// Source of the party ID of each player
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Assign")
+	FTeamAssignPlayerValue PartyId;
+
+protected:
+	virtual void ProcessAssign(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const override;
+	virtual void ProcessAssignBatch(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const override;
+
+	/**
+	 * Returns the party ID of the player or an empty string if the player is not in a party
+	 */
+	FString GetPartyId(const APlayerState* PlayerState) const;
+
+public:
+	/**
+	 * Pack the groups into the teams, keeping each group on a single team
+	 * 
+	 * Tips:
+	 *	TeamCounts holds the current number of players of each team and is updated with the groups,
+	 *	OutTeamIndices receives the index of the team for each group
+	 */
+	static void PackGroups(TConstArrayView<int32> GroupSizes, TArray<int32>& TeamCounts, TArray<int32>& OutTeamIndices);
+
+};
@@ -0,0 +1,318 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamAssign_SkillBalanced.h"
+
+#include "TeamFunctionLibrary.h"
+#include "TeamCreationData.h"
+#include "TeamMemberComponent.h"
+#include "TeamManagerSubsystem.h"
+#include "GTExtLogs.h"
+
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamAssign_SkillBalanced)
+
+
+FString FTeamBalanceMetrics::ToString() const
+{
+	return FString::Printf(TEXT("Rating Sum [Min: %.1f, Max: %.1f, Mean: %.1f], Spread: %.1f (%.2f%%), Count [Min: %d, Max: %d]"),
+		MinRatingSum, MaxRatingSum, MeanRatingSum, Spread, RelativeSpread * 100.0, MinCount, MaxCount);
+}
+
+
+UTeamAssign_SkillBalanced::UTeamAssign_SkillBalanced(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+
+void UTeamAssign_SkillBalanced::ProcessAssign(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const
+{
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
+	auto* TMC{ TMS ? TMS->FindTeamMemberComponent(PlayerState) : nullptr };
+	if (!ensure(TMC))
+	{
+		return;
+	}
+
+	TSet<const UTeamMemberComponent*> IgnoredMembers;
+	IgnoredMembers.Add(TMC);
+
+	TArray<FTeamRatingBucket> Buckets;
+	GatherTeamBuckets(TeamCreationData, TMS, IgnoredMembers, Buckets);
+
+	// Join the weakest team among the teams with the fewest players, then the team with the lowest ID
+
+	const FTeamRatingBucket* BestBucket{ nullptr };
+
+	for (const auto& Bucket : Buckets)
+	{
+		if (!BestBucket
+			|| (Bucket.Count < BestBucket->Count)
+			|| ((Bucket.Count == BestBucket->Count) && (Bucket.RatingSum < BestBucket->RatingSum)))
+		{
+			BestBucket = &Bucket;
+		}
+	}
+
+	TMC->SetGenericTeamId(BestBucket ? UTeamFunctionLibrary::IntegerToGenericTeamId(BestBucket->TeamId) : FGenericTeamId::NoTeam);
+}
+
+void UTeamAssign_SkillBalanced::ProcessAssignBatch(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const
+{
+	if (!IsBuiltInAssign(UTeamAssign_SkillBalanced::StaticClass()))
+	{
+		Super::ProcessAssignBatch(TeamCreationData, PlayerStates, GameState);
+		return;
+	}
+
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GameState->GetWorld()) };
+	if (!ensure(TMS))
+	{
+		return;
+	}
+
+	// Players without a team from the game mode option are partitioned together
+
+	TArray<APlayerState*> PendingPlayers;
+	TArray<UTeamMemberComponent*> PendingMembers;
+	AssignSpectatorsAndOptionPlayers(TeamCreationData, PlayerStates, GameState, PendingPlayers, PendingMembers);
+
+	if (PendingMembers.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<double> Ratings;
+	Ratings.Reserve(PendingPlayers.Num());
+
+	for (const auto* PlayerState : PendingPlayers)
+	{
+		Ratings.Add(Rating.GetValue(PlayerState));
+	}
+
+	TSet<const UTeamMemberComponent*> IgnoredMembers;
+	IgnoredMembers.Reserve(PendingMembers.Num());
+
+	for (const auto* TMC : PendingMembers)
+	{
+		IgnoredMembers.Add(TMC);
+	}
+
+	TArray<FTeamRatingBucket> Buckets;
+	GatherTeamBuckets(TeamCreationData, TMS, IgnoredMembers, Buckets);
+
+	if (Buckets.IsEmpty())
+	{
+		for (auto* TMC : PendingMembers)
+		{
+			TMC->SetGenericTeamId(FGenericTeamId::NoTeam);
+		}
+
+		return;
+	}
+
+	const auto StartCycles{ FPlatformTime::Cycles64() };
+
+	TArray<int32> BucketIndices;
+	PartitionByRating(Ratings, Buckets, BucketIndices, MaxRefinementSwaps);
+
+	const auto ElapsedMs{ FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) };
+
+	for (auto Index{ 0 }; Index < PendingMembers.Num(); ++Index)
+	{
+		PendingMembers[Index]->SetGenericTeamId(UTeamFunctionLibrary::IntegerToGenericTeamId(Buckets[BucketIndices[Index]].TeamId));
+	}
+
+	if (bLogBalanceMetrics)
+	{
+		UE_LOG(LogGameExt_Team, Log, TEXT("Skill balanced %d players into %d teams in %.3f ms"), PendingMembers.Num(), Buckets.Num(), ElapsedMs);
+		UE_LOG(LogGameExt_Team, Log, TEXT("| %s"), *ComputeBalanceMetrics(Buckets).ToString());
+	}
+}
+
+void UTeamAssign_SkillBalanced::GatherTeamBuckets(const UTeamCreationData* TeamCreationData, const UTeamManagerSubsystem* TMS, const TSet<const UTeamMemberComponent*>& IgnoredMembers, TArray<FTeamRatingBucket>& OutBuckets) const
+{
+	OutBuckets.Reset(TeamCreationData->TeamsToCreate.Num());
+
+	for (const auto& KVP : TeamCreationData->TeamsToCreate)
+	{
+		auto& Bucket{ OutBuckets.Emplace_GetRef(static_cast<int32>(KVP.Key)) };
+
+		TMS->ForEachMemberOfTeam(Bucket.TeamId, [this, &Bucket, &IgnoredMembers](const UTeamMemberComponent* Member)
+		{
+			if (Member->IsActiveTeamMember() && !IgnoredMembers.Contains(Member))
+			{
+				Bucket.Count++;
+				Bucket.RatingSum += Rating.GetValue(Cast<APlayerState>(Member->GetOwner()));
+			}
+		});
+	}
+
+	// Keep the order of team IDs so that ties are always resolved to the lowest team ID
+
+	OutBuckets.Sort([](const FTeamRatingBucket& A, const FTeamRatingBucket& B) { return A.TeamId < B.TeamId; });
+}
+
+
+void UTeamAssign_SkillBalanced::PartitionByRating(TConstArrayView<double> Ratings, TArray<FTeamRatingBucket>& Buckets, TArray<int32>& OutBucketIndices, int32 MaxRefinementSwaps)
+{
+	const auto NumPlayers{ Ratings.Num() };
+	const auto NumBuckets{ Buckets.Num() };
+
+	OutBucketIndices.Init(INDEX_NONE, NumPlayers);
+
+	if ((NumPlayers <= 0) || (NumBuckets <= 0))
+	{
+		return;
+	}
+
+	// Give the strongest remaining player to the weakest of the teams with the fewest players, so that team sizes stay even
+
+	TArray<int32, TInlineAllocator<256>> Order;
+	Order.SetNumUninitialized(NumPlayers);
+
+	for (auto Index{ 0 }; Index < NumPlayers; ++Index)
+	{
+		Order[Index] = Index;
+	}
+
+	Order.Sort([&Ratings](int32 A, int32 B)
+	{
+		return (Ratings[A] > Ratings[B]) || ((Ratings[A] == Ratings[B]) && (A < B));
+	});
+
+	for (const auto& PlayerIndex : Order)
+	{
+		auto BestBucketIndex{ static_cast<int32>(INDEX_NONE) };
+
+		for (auto BucketIndex{ 0 }; BucketIndex < NumBuckets; ++BucketIndex)
+		{
+			const auto& Bucket{ Buckets[BucketIndex] };
+
+			if ((BestBucketIndex == INDEX_NONE)
+				|| (Bucket.Count < Buckets[BestBucketIndex].Count)
+				|| ((Bucket.Count == Buckets[BestBucketIndex].Count) && (Bucket.RatingSum < Buckets[BestBucketIndex].RatingSum)))
+			{
+				BestBucketIndex = BucketIndex;
+			}
+		}
+
+		check(BestBucketIndex != INDEX_NONE);
+
+		auto& BestBucket{ Buckets[BestBucketIndex] };
+		BestBucket.Count++;
+		BestBucket.RatingSum += Ratings[PlayerIndex];
+
+		OutBucketIndices[PlayerIndex] = BestBucketIndex;
+	}
+
+	// Swap one player between the strongest and weakest teams while it reduces the difference between them
+
+	TArray<int32, TInlineAllocator<128>> StrongPlayers;
+	TArray<int32, TInlineAllocator<128>> WeakPlayers;
+
+	for (auto SwapIndex{ 0 }; SwapIndex < MaxRefinementSwaps; ++SwapIndex)
+	{
+		auto StrongIndex{ 0 };
+		auto WeakIndex{ 0 };
+
+		for (auto BucketIndex{ 1 }; BucketIndex < NumBuckets; ++BucketIndex)
+		{
+			if (Buckets[BucketIndex].RatingSum > Buckets[StrongIndex].RatingSum)
+			{
+				StrongIndex = BucketIndex;
+			}
+
+			if (Buckets[BucketIndex].RatingSum < Buckets[WeakIndex].RatingSum)
+			{
+				WeakIndex = BucketIndex;
+			}
+		}
+
+		const auto Difference{ Buckets[StrongIndex].RatingSum - Buckets[WeakIndex].RatingSum };
+		if (Difference <= 0.0)
+		{
+			break;
+		}
+
+		StrongPlayers.Reset();
+		WeakPlayers.Reset();
+
+		for (auto PlayerIndex{ 0 }; PlayerIndex < NumPlayers; ++PlayerIndex)
+		{
+			if (OutBucketIndices[PlayerIndex] == StrongIndex)
+			{
+				StrongPlayers.Add(PlayerIndex);
+			}
+			else if (OutBucketIndices[PlayerIndex] == WeakIndex)
+			{
+				WeakPlayers.Add(PlayerIndex);
+			}
+		}
+
+		auto BestStrongPlayer{ static_cast<int32>(INDEX_NONE) };
+		auto BestWeakPlayer{ static_cast<int32>(INDEX_NONE) };
+		auto BestDifference{ Difference };
+
+		for (const auto& StrongPlayer : StrongPlayers)
+		{
+			for (const auto& WeakPlayer : WeakPlayers)
+			{
+				const auto Delta{ Ratings[StrongPlayer] - Ratings[WeakPlayer] };
+				const auto NewDifference{ FMath::Abs(Difference - (2.0 * Delta)) };
+
+				if ((Delta > 0.0) && (NewDifference < BestDifference))
+				{
+					BestStrongPlayer = StrongPlayer;
+					BestWeakPlayer = WeakPlayer;
+					BestDifference = NewDifference;
+				}
+			}
+		}
+
+		if (BestStrongPlayer == INDEX_NONE)
+		{
+			break;
+		}
+
+		const auto Delta{ Ratings[BestStrongPlayer] - Ratings[BestWeakPlayer] };
+
+		Buckets[StrongIndex].RatingSum -= Delta;
+		Buckets[WeakIndex].RatingSum += Delta;
+
+		OutBucketIndices[BestStrongPlayer] = WeakIndex;
+		OutBucketIndices[BestWeakPlayer] = StrongIndex;
+	}
+}
+
+FTeamBalanceMetrics UTeamAssign_SkillBalanced::ComputeBalanceMetrics(TConstArrayView<FTeamRatingBucket> Buckets)
+{
+	FTeamBalanceMetrics Metrics;
+
+	if (Buckets.IsEmpty())
+	{
+		return Metrics;
+	}
+
+	Metrics.MinRatingSum = TNumericLimits<double>::Max();
+	Metrics.MaxRatingSum = TNumericLimits<double>::Lowest();
+	Metrics.MinCount = TNumericLimits<int32>::Max();
+	Metrics.MaxCount = TNumericLimits<int32>::Lowest();
+
+	for (const auto& Bucket : Buckets)
+	{
+		Metrics.MinRatingSum = FMath::Min(Metrics.MinRatingSum, Bucket.RatingSum);
+		Metrics.MaxRatingSum = FMath::Max(Metrics.MaxRatingSum, Bucket.RatingSum);
+		Metrics.MeanRatingSum += Bucket.RatingSum;
+		Metrics.MinCount = FMath::Min(Metrics.MinCount, Bucket.Count);
+		Metrics.MaxCount = FMath::Max(Metrics.MaxCount, Bucket.Count);
+	}
+
+	Metrics.MeanRatingSum /= Buckets.Num();
+	Metrics.Spread = Metrics.MaxRatingSum - Metrics.MinRatingSum;
+	Metrics.RelativeSpread = (FMath::Abs(Metrics.MeanRatingSum) > UE_DOUBLE_SMALL_NUMBER) ? (Metrics.Spread / FMath::Abs(Metrics.MeanRatingSum)) : 0.0;
+
+	return Metrics;
+}
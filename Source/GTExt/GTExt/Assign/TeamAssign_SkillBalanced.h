@@ -0,0 +1,121 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "TeamAssignBase.h"
+
+#include "TeamAssignPlayerValue.h"
+
+#include "TeamAssign_SkillBalanced.generated.h"
+
+class UTeamManagerSubsystem;
+class UTeamMemberComponent;
+
+
+/**
+ * Team with the players assigned to it, used to partition players by rating
+ */
+struct FTeamRatingBucket
+{
+public:
+	FTeamRatingBucket() {}
+	FTeamRatingBucket(int32 InTeamId, int32 InCount = 0, double InRatingSum = 0.0)
+		: TeamId(InTeamId), Count(InCount), RatingSum(InRatingSum)
+	{}
+
+public:
+	int32 TeamId{ INDEX_NONE };
+
+	int32 Count{ 0 };
+
+	double RatingSum{ 0.0 };
+};
+
+
+/**
+ * Metrics of how evenly the ratings are distributed between teams
+ */
+struct FTeamBalanceMetrics
+{
+public:
+	double MinRatingSum{ 0.0 };
+	double MaxRatingSum{ 0.0 };
+	double MeanRatingSum{ 0.0 };
+
+	//
+	// Difference between the strongest and the weakest team
+	//
+	double Spread{ 0.0 };
+
+	//
+	// Spread relative to the mean rating of a team
+	//
+	double RelativeSpread{ 0.0 };
+
+	int32 MinCount{ 0 };
+	int32 MaxCount{ 0 };
+
+public:
+	FString ToString() const;
+};
+
+
+/**
+ * Team assignment that balances the total rating of each team
+ * 
+ * Tips:
+ *	Players assigned together are sorted by rating and greedily given to the weakest of the teams with the fewest players
+ *	(longest processing time first), then the strongest and weakest teams swap players while it reduces the spread.
+ *	Swaps keep team sizes, so team sizes never differ by more than one player unless they already did before this batch.
+ *	Players joining later are given to the weakest team among the teams with the fewest players
+ */
+UCLASS(meta = (DisplayName = "Skill Balanced"))
+class GTEXT_API UTeamAssign_SkillBalanced : public UTeamAssignBase
+{
+	GENERATED_BODY()
+public:
+	UTeamAssign_SkillBalanced(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+protected:
+	//
+	// Source of the rating of each player
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Assign")
+	FTeamAssignPlayerValue Rating;
+
+	//
+	// Maximum number of swaps between the strongest and weakest teams after the greedy assignment
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Assign", meta = (ClampMin = 0))
+	int32 MaxRefinementSwaps{ 16 };
+
+	//
+	// Whether the balance of the teams is logged after assigning players together
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Assign")
+	bool bLogBalanceMetrics{ true };
+
+protected:
+	virtual void ProcessAssign(const UTeamCreationData* TeamCreationData, APlayerState* PlayerState, AGameStateBase* GameState) const override;
+	virtual void ProcessAssignBatch(const UTeamCreationData* TeamCreationData, TArrayView<APlayerState* const> PlayerStates, AGameStateBase* GameState) const override;
+
+	/**
+	 * Create buckets of the current teams from the active members that are not in the ignored set
+	 */
+	void GatherTeamBuckets(const UTeamCreationData* TeamCreationData, const UTeamManagerSubsystem* TMS, const TSet<const UTeamMemberComponent*>& IgnoredMembers, TArray<FTeamRatingBucket>& OutBuckets) const;
+
+public:
+	/**
+	 * Partition the ratings between the buckets
+	 * 
+	 * Tips:
+	 *	OutBucketIndices receives the index of the bucket for each rating, and the buckets are updated with the new players
+	 */
+	static void PartitionByRating(TConstArrayView<double> Ratings, TArray<FTeamRatingBucket>& Buckets, TArray<int32>& OutBucketIndices, int32 MaxRefinementSwaps);
+
+	/**
+	 * Returns how evenly the ratings are distributed between the buckets
+	 */
+	static FTeamBalanceMetrics ComputeBalanceMetrics(TConstArrayView<FTeamRatingBucket> Buckets);
+
+};
@@ -0,0 +1,108 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamPopulationHeap.h"
+
+
+void FTeamPopulationHeap::Add(int32 TeamId, int32 Population)
+{
+	check((TeamId >= 0) && (TeamId < MaxTeams));
+
+	if (HeapIndices[TeamId] != INDEX_NONE)
+	{
+		Update(TeamId, Population);
+		return;
+	}
+
+	const auto Index{ Nodes.Add({ Population, TeamId }) };
+	HeapIndices[TeamId] = Index;
+
+	SiftUp(Index);
+}
+
+void FTeamPopulationHeap::Reset()
+{
+	Nodes.Reset();
+
+	for (auto& HeapIndex : HeapIndices)
+	{
+		HeapIndex = INDEX_NONE;
+	}
+}
+
+void FTeamPopulationHeap::Update(int32 TeamId, int32 NewPopulation)
+{
+	if (!Contains(TeamId))
+	{
+		return;
+	}
+
+	const auto Index{ HeapIndices[TeamId] };
+	const auto OldPopulation{ Nodes[Index].Population };
+
+	Nodes[Index].Population = NewPopulation;
+
+	if (NewPopulation < OldPopulation)
+	{
+		SiftUp(Index);
+	}
+	else if (NewPopulation > OldPopulation)
+	{
+		SiftDown(Index);
+	}
+}
+
+
+void FTeamPopulationHeap::SiftUp(int32 Index)
+{
+	while (Index > 0)
+	{
+		const auto ParentIndex{ (Index - 1) / 2 };
+
+		if (!IsLess(Nodes[Index], Nodes[ParentIndex]))
+		{
+			break;
+		}
+
+		Swap(Index, ParentIndex);
+		Index = ParentIndex;
+	}
+}
+
+void FTeamPopulationHeap::SiftDown(int32 Index)
+{
+	const auto NumNodes{ Nodes.Num() };
+
+	while (true)
+	{
+		const auto LeftIndex{ (Index * 2) + 1 };
+		const auto RightIndex{ LeftIndex + 1 };
+
+		auto SmallestIndex{ Index };
+
+		if ((LeftIndex < NumNodes) && IsLess(Nodes[LeftIndex], Nodes[SmallestIndex]))
+		{
+			SmallestIndex = LeftIndex;
+		}
+
+		if ((RightIndex < NumNodes) && IsLess(Nodes[RightIndex], Nodes[SmallestIndex]))
+		{
+			SmallestIndex = RightIndex;
+		}
+
+		if (SmallestIndex == Index)
+		{
+			break;
+		}
+
+		Swap(Index, SmallestIndex);
+		Index = SmallestIndex;
+	}
+}
+
+void FTeamPopulationHeap::Swap(int32 IndexA, int32 IndexB)
+{
+	Nodes.Swap(IndexA, IndexB);
+
+	HeapIndices[Nodes[IndexA].TeamId] = IndexA;
+	HeapIndices[Nodes[IndexB].TeamId] = IndexB;
+}
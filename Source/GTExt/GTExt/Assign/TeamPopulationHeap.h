@@ -0,0 +1,80 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+
+/**
+ * Indexed min-heap of team populations used for bulk team assignment
+ *
+ * Tips:
+ *	The top of the heap is the team with the lowest population, then with the lowest ID,
+ *	which is the same rule used when assigning players one by one
+ */
+class GTEXT_API FTeamPopulationHeap
+{
+public:
+	FTeamPopulationHeap() { Reset(); }
+
+	//
+	// Number of team IDs that can be represented by FGenericTeamId
+	//
+	static constexpr int32 MaxTeams{ 256 };
+
+protected:
+	struct FNode
+	{
+	public:
+		int32 Population{ 0 };
+		int32 TeamId{ INDEX_NONE };
+	};
+
+	TArray<FNode, TInlineAllocator<16>> Nodes;
+
+	int32 HeapIndices[MaxTeams];
+
+protected:
+	static FORCEINLINE bool IsLess(const FNode& A, const FNode& B)
+	{
+		return (A.Population < B.Population) || ((A.Population == B.Population) && (A.TeamId < B.TeamId));
+	}
+
+	void SiftUp(int32 Index);
+	void SiftDown(int32 Index);
+	void Swap(int32 IndexA, int32 IndexB);
+
+public:
+	/**
+	 * Add team with its current population
+	 */
+	void Add(int32 TeamId, int32 Population);
+
+	/**
+	 * Remove all teams
+	 */
+	void Reset();
+
+	/**
+	 * Update the population of the team
+	 */
+	void Update(int32 TeamId, int32 NewPopulation);
+
+	FORCEINLINE bool Contains(int32 TeamId) const
+	{
+		return (TeamId >= 0) && (TeamId < MaxTeams) && (HeapIndices[TeamId] != INDEX_NONE);
+	}
+
+	FORCEINLINE bool IsEmpty() const { return Nodes.IsEmpty(); }
+	FORCEINLINE int32 Num() const { return Nodes.Num(); }
+
+	/**
+	 * Returns the team with the lowest population, then the lowest ID
+	 */
+	FORCEINLINE int32 GetTopTeamId() const { return Nodes.IsEmpty() ? INDEX_NONE : Nodes[0].TeamId; }
+	FORCEINLINE int32 GetTopPopulation() const { return Nodes.IsEmpty() ? 0 : Nodes[0].Population; }
+
+	FORCEINLINE int32 GetPopulation(int32 TeamId) const
+	{
+		return Contains(TeamId) ? Nodes[HeapIndices[TeamId]].Population : 0;
+	}
+
+};
@@ -8,12 +8,20 @@
 #include "Net/UnrealNetwork.h"
 #include "Net/Core/PushModel/PushModel.h"
 #include "GameFramework/GameModeBase.h"
-#include "Kismet/GameplayStatics.h"
-#include "GameplayTagsManager.h"
+#include "Engine/ActorChannel.h"
+#include "Net/DataBunch.h"
+#include "EngineUtils.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(TeamInfoBase)
 
 
+DECLARE_STATS_GROUP(TEXT("GTExt Team"), STATGROUP_GTExtTeam, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Team Tag Changes Replicated"), STAT_GTExt_TeamTagChanges, STATGROUP_GTExtTeam);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Team Info Property Bytes Sent"), STAT_GTExt_TeamTagBytes, STATGROUP_GTExtTeam);
+
+
 ATeamInfoBase::ATeamInfoBase(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 	, TeamTags(this)
@@ -22,6 +30,10 @@ ATeamInfoBase::ATeamInfoBase(const FObjectInitializer& ObjectInitializer)
 	bAlwaysRelevant = true;
 	NetPriority = 3.0f;
 	SetReplicatingMovement(false);
+
+	// ReplicateSubobjects() measures the property bytes written to each connection
+
+	bReplicateUsingRegisteredSubObjectList = false;
 }
 
 void ATeamInfoBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -46,10 +58,19 @@ void ATeamInfoBase::BeginPlay()
 	Super::BeginPlay();
 
 	TryRegisterWithTeamManagerSubsystem();
+
+	if (HasAuthority() && (GetNetMode() != NM_Standalone))
+	{
+		TagBytesWindowStartTime = GetWorld()->GetTimeSeconds();
+		GetWorldTimerManager().SetTimer(TagBytesWindowTimerHandle, this, &ThisClass::CloseTagBytesWindow, 1.0f, true);
+	}
 }
 
 void ATeamInfoBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	GetWorldTimerManager().ClearTimer(TagReplicationTimerHandle);
+	GetWorldTimerManager().ClearTimer(TagBytesWindowTimerHandle);
+
 	if (TeamId != INDEX_NONE)
 	{
 		auto* TMS{ GetWorld()->GetSubsystem<UTeamManagerSubsystem>() };
@@ -60,6 +81,20 @@ void ATeamInfoBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
 }
 
 
+bool ATeamInfoBase::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	// At this point the bunch only holds the properties of this actor written for the connection of the channel.
+	// The initial bunch also holds the spawn info, so it is not counted
+
+	if (Bunch && RepFlags && !RepFlags->bNetInitial)
+	{
+		RecordReplicatedBytes((Bunch->GetNumBits() + 7) >> 3);
+	}
+
+	return Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
+}
+
+
 void ATeamInfoBase::TryRegisterWithTeamManagerSubsystem()
 {
 	if (TeamId != INDEX_NONE)
@@ -93,52 +128,259 @@ void ATeamInfoBase::OnRep_TeamId()
 }
 
 
-// Game Mode Option
+// Team Tag Replication
 
-bool ATeamInfoBase::InitializeFromGameModeOption()
+int32 ATeamInfoBase::FindTagReplicationPolicyIndex(const FGameplayTag& Tag)
 {
-	auto* GameMode{ GetWorld()->GetAuthGameMode() };
-	if (ensure(GameMode))
+	if (TagReplicationPolicies.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	if (const auto* CachedIndex{ TagPolicyIndices.Find(Tag) })
 	{
-		auto OptionString{ GameMode->OptionsString };
-		const auto OptionKey{ FString::Printf(TEXT("Team[%d]"), TeamId) };
+		return *CachedIndex;
+	}
 
-		UE_LOG(LogGameExt_Team, Log, TEXT("| Team[%d]"), TeamId);
+	const auto PolicyIndex
+	{
+		TagReplicationPolicies.IndexOfByPredicate([&Tag](const FTeamTagReplicationPolicy& Policy)
+		{
+			return Tag.MatchesTag(Policy.Tag);
+		})
+	};
+
+	TagPolicyIndices.Add(Tag, PolicyIndex);
+
+	return PolicyIndex;
+}
+
+void ATeamInfoBase::SetThrottledTagStack(const FGameplayTag& Tag, int32 PolicyIndex, int32 NewStackCount)
+{
+	auto& Entry{ ThrottledTagStacks.FindOrAdd(Tag) };
+	Entry.StackCount = NewStackCount;
+	Entry.PolicyIndex = PolicyIndex;
+
+	// Changes that do not change the replicated value are only kept on the server
+
+	Entry.bDirty = (TagReplicationPolicies[PolicyIndex].Quantize(NewStackCount) != TeamTags.GetStackCount(Tag));
+
+	if (!Entry.bDirty)
+	{
+		return;
+	}
+
+	const auto DueTime{ Entry.LastReplicatedTime + TagReplicationPolicies[PolicyIndex].MinInterval };
+
+	if (DueTime <= GetWorld()->GetTimeSeconds())
+	{
+		ReplicateThrottledTagStack(Tag, Entry, false);
+	}
+	else
+	{
+		ScheduleTagReplication(DueTime);
+	}
+}
+
+void ATeamInfoBase::ReplicateThrottledTagStack(const FGameplayTag& Tag, FThrottledTagStack& Entry, bool bExact)
+{
+	const auto& Policy{ TagReplicationPolicies[Entry.PolicyIndex] };
+	const auto ReplicatedStackCount{ bExact ? Entry.StackCount : Policy.Quantize(Entry.StackCount) };
+
+	if (ReplicatedStackCount != TeamTags.GetStackCount(Tag))
+	{
+		TeamTags.SetStack(Tag, ReplicatedStackCount);
+
+		Entry.LastReplicatedTime = GetWorld()->GetTimeSeconds();
+
+		RecordTagReplication(1);
+	}
+
+	Entry.bDirty = false;
+
+	// Keep the exact value in sync with limits applied by the container (e.g., max stack count)
+
+	if (ReplicatedStackCount == Entry.StackCount)
+	{
+		Entry.StackCount = TeamTags.GetStackCount(Tag);
+	}
+}
+
+void ATeamInfoBase::ScheduleTagReplication(double DueTime)
+{
+	auto& TimerManager{ GetWorldTimerManager() };
+	const auto Delay{ FMath::Max(static_cast<float>(DueTime - GetWorld()->GetTimeSeconds()), KINDA_SMALL_NUMBER) };
+
+	if (!TimerManager.IsTimerActive(TagReplicationTimerHandle) || (TimerManager.GetTimerRemaining(TagReplicationTimerHandle) > Delay))
+	{
+		TimerManager.SetTimer(TagReplicationTimerHandle, this, &ThisClass::HandleTagReplicationTimer, Delay, false);
+	}
+}
 
-		// Retrieve information about the team corresponding to this TeamInfo from the game mode options
+void ATeamInfoBase::HandleTagReplicationTimer()
+{
+	const auto CurrentTime{ GetWorld()->GetTimeSeconds() };
+	auto NextDueTime{ TNumericLimits<double>::Max() };
+
+	for (auto& KVP : ThrottledTagStacks)
+	{
+		auto& Entry{ KVP.Value };
 
-		if (UGameplayStatics::HasOption(OptionString, OptionKey))
+		if (!Entry.bDirty)
 		{
-			auto OptionValue{ UGameplayStatics::ParseOption(OptionString, OptionKey) };
-			
-			UE_LOG(LogGameExt_Team, Log, TEXT("| | OptionValue: %s"), *OptionValue);
+			continue;
+		}
 
-			// Query StatTag information about TeamInfo
+		const auto DueTime{ Entry.LastReplicatedTime + TagReplicationPolicies[Entry.PolicyIndex].MinInterval };
 
-			TArray<FString> Stats;
-			OptionValue.ParseIntoArray(Stats, TEXT(":"));
-			for (const auto& Stat : Stats)
-			{
-				// Query the value of StatTag
+		if (DueTime <= CurrentTime + KINDA_SMALL_NUMBER)
+		{
+			ReplicateThrottledTagStack(KVP.Key, Entry, false);
+		}
+		else
+		{
+			NextDueTime = FMath::Min(NextDueTime, DueTime);
+		}
+	}
+
+	if (NextDueTime < TNumericLimits<double>::Max())
+	{
+		ScheduleTagReplication(NextDueTime);
+	}
+}
+
+void ATeamInfoBase::RecordTagReplication(int32 NumChanges)
+{
+	INC_DWORD_STAT_BY(STAT_GTExt_TeamTagChanges, NumChanges);
+}
+
+void ATeamInfoBase::RecordReplicatedBytes(int64 Bytes)
+{
+	if (Bytes > 0)
+	{
+		INC_DWORD_STAT_BY(STAT_GTExt_TeamTagBytes, Bytes);
+
+		TagBytesInWindow += Bytes;
+	}
+}
+
+void ATeamInfoBase::CloseTagBytesWindow()
+{
+	// Closed by a timer so that the rate falls back to zero once changes stop
+
+	const auto CurrentTime{ GetWorld()->GetTimeSeconds() };
+	const auto WindowLength{ CurrentTime - TagBytesWindowStartTime };
+
+	if (WindowLength > UE_KINDA_SMALL_NUMBER)
+	{
+		TagBytesPerSecond = static_cast<float>(TagBytesInWindow / WindowLength);
+	}
+
+	TagBytesInWindow = 0;
+	TagBytesWindowStartTime = CurrentTime;
+}
+
+
+void ATeamInfoBase::AddTeamTagStack(FGameplayTag Tag, int32 StackCount)
+{
+	if (StackCount < 1)
+	{
+		return;
+	}
+
+	const auto PolicyIndex{ FindTagReplicationPolicyIndex(Tag) };
+
+	if (PolicyIndex == INDEX_NONE)
+	{
+		TeamTags.AddStack(Tag, StackCount);
+		RecordTagReplication(1);
+	}
+	else
+	{
+		SetThrottledTagStack(Tag, PolicyIndex, GetTeamTagStackCount(Tag) + StackCount);
+	}
+}
+
+void ATeamInfoBase::RemoveTeamTagStack(FGameplayTag Tag, int32 StackCount)
+{
+	if (StackCount < 1)
+	{
+		return;
+	}
+
+	const auto PolicyIndex{ FindTagReplicationPolicyIndex(Tag) };
+
+	if (PolicyIndex == INDEX_NONE)
+	{
+		TeamTags.RemoveStack(Tag, StackCount);
+		RecordTagReplication(1);
+	}
+	else
+	{
+		SetThrottledTagStack(Tag, PolicyIndex, FMath::Max(GetTeamTagStackCount(Tag) - StackCount, 0));
+	}
+}
+
+void ATeamInfoBase::SetTeamTagStack(FGameplayTag Tag, int32 StackCount)
+{
+	const auto PolicyIndex{ FindTagReplicationPolicyIndex(Tag) };
+
+	if (PolicyIndex == INDEX_NONE)
+	{
+		TeamTags.SetStack(Tag, StackCount);
+		RecordTagReplication(1);
+	}
+	else
+	{
+		SetThrottledTagStack(Tag, PolicyIndex, StackCount);
+	}
+}
+
+int32 ATeamInfoBase::GetTeamTagStackCount(FGameplayTag Tag) const
+{
+	const auto* Entry{ ThrottledTagStacks.Find(Tag) };
+	return Entry ? Entry->StackCount : TeamTags.GetStackCount(Tag);
+}
+
+void ATeamInfoBase::FlushTeamTagStacks()
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	GetWorldTimerManager().ClearTimer(TagReplicationTimerHandle);
+
+	for (auto& KVP : ThrottledTagStacks)
+	{
+		ReplicateThrottledTagStack(KVP.Key, KVP.Value, true);
+	}
+}
 
-				TArray<FString> Values;
-				Stat.ParseIntoArray(Values, TEXT(","));
 
-				// Check if the value is correct.
+// Game Mode Option
+
+bool ATeamInfoBase::InitializeFromGameModeOption()
+{
+	auto* GameMode{ GetWorld()->GetAuthGameMode() };
+	auto* TMS{ GetWorld()->GetSubsystem<UTeamManagerSubsystem>() };
 
-				static constexpr int32 NumValues{ 3 };
+	if (ensure(GameMode) && ensure(TMS))
+	{
+		UE_LOG(LogGameExt_Team, Log, TEXT("| Team[%d]"), TeamId);
 
-				if (ensure(Values.Num() == NumValues))
-				{
-					UE_LOG(LogGameExt_Team, Log, TEXT("| | | Tag: %s"), *Values[0]);
-					UE_LOG(LogGameExt_Team, Log, TEXT("| | | Val: %s"), *Values[1]);
-					UE_LOG(LogGameExt_Team, Log, TEXT("| | | Max: %s"), *Values[2]);
+		// Retrieve information about the team corresponding to this TeamInfo from the pre-parsed game mode options
 
-					const auto Tag{ UGameplayTagsManager::Get().RequestGameplayTag(FName(Values[0]), true) };
+		if (const auto* Stats{ TMS->GetGameModeOptionIndex(GameMode).FindTeamStats(TeamId) })
+		{
+			for (const auto& Stat : *Stats)
+			{
+				UE_LOG(LogGameExt_Team, Log, TEXT("| | | Tag: %s"), *Stat.Tag.ToString());
+				UE_LOG(LogGameExt_Team, Log, TEXT("| | | Val: %d"), Stat.StackCount);
+				UE_LOG(LogGameExt_Team, Log, TEXT("| | | Max: %d"), Stat.MaxStackCount);
 
-					TeamTags.SetMaxStack(Tag, FCString::Atoi(*Values[2]));
-					TeamTags.SetStack(Tag, FCString::Atoi(*Values[1]));
-				}
+				TeamTags.SetMaxStack(Stat.Tag, Stat.MaxStackCount);
+				TeamTags.SetStack(Stat.Tag, Stat.StackCount);
 			}
 		}
 		else
@@ -156,14 +398,33 @@ FString ATeamInfoBase::ConstructGameModeOption() const
 {
 	FString ScoreOption;
 
-	for (const auto& KVP : TeamTags.FastStacks)
+	ForEachTeamTagStack([&ScoreOption](const FGameplayTag& Tag, int32 Val, int32 Max)
 	{
-		const auto Tag{ KVP.Key };
-		const auto Val{ KVP.Value.StackCount };
-		const auto Max{ KVP.Value.MaxStackCount };
-
 		ScoreOption += FString::Printf(TEXT("%s,%d,%d:"), *Tag.ToString(), Val, Max);
-	}
+	});
 
 	return FString::Printf(TEXT("?Team[%d]=%s"), TeamId, *ScoreOption);
 }
+
+
+#if !UE_BUILD_SHIPPING
+
+namespace TeamInfoBaseLocals
+{
+	static void LogTagReplicationStats(UWorld* World)
+	{
+		UE_LOG(LogGameExt_Team, Display, TEXT("Team tag replication (measured property bytes per second sent to all connections)"));
+
+		for (const auto* TeamInfo : TActorRange<ATeamInfoBase>(World))
+		{
+			UE_LOG(LogGameExt_Team, Display, TEXT("| Team[%d] %s: %.1f B/s"), TeamInfo->GetTeamId(), *GetNameSafe(TeamInfo), TeamInfo->GetTagReplicationBytesPerSecond());
+		}
+	}
+
+	static FAutoConsoleCommandWithWorld LogTagReplicationStatsCommand(
+		TEXT("GTExt.Stats.TeamTagReplication"),
+		TEXT("Log the measured property bytes per second sent for each team info"),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&LogTagReplicationStats));
+}
+
+#endif
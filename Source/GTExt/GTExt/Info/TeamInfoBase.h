@@ -7,6 +7,9 @@
 #include "GameplayTag/GameplayTagStack.h"
 #include "GameplayTag/GameplayTagStackInterface.h"
 
+#include "Replication/TeamReplicationPolicy.h"
+#include "Replication/TeamTagReplicationPolicy.h"
+
 #include "TeamInfoBase.generated.h"
 
 class UTeamManagerSubsystem;
@@ -32,6 +35,7 @@ public:
 public:
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
 
 protected:
 	/**
@@ -54,6 +58,130 @@ protected:
 	virtual const FGameplayTagStackContainer* GetStatTagsConst() const override { return &TeamTags; }
 
 
+	////////////////////////////////////////////////////
+	// Team Tag Replication
+protected:
+	//
+	// Replication policies of team tags
+	// 
+	// Tips:
+	//	Tags without a policy are replicated on every change.
+	//	The first policy whose tag matches is used, so list more specific tags first
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Replication")
+	TArray<FTeamTagReplicationPolicy> TagReplicationPolicies;
+
+	/**
+	 * Server side state of a tag replicated with a policy
+	 */
+	struct FThrottledTagStack
+	{
+	public:
+		int32 StackCount{ 0 };
+
+		int32 PolicyIndex{ INDEX_NONE };
+
+		double LastReplicatedTime{ TNumericLimits<double>::Lowest() };
+
+		bool bDirty{ false };
+	};
+
+	//
+	// Exact stack counts of tags with a policy, which may be ahead of the replicated TeamTags
+	//
+	TMap<FGameplayTag, FThrottledTagStack> ThrottledTagStacks;
+
+	//
+	// Index of the policy of each tag changed so far (INDEX_NONE when the tag has no policy)
+	//
+	TMap<FGameplayTag, int32> TagPolicyIndices;
+
+	FTimerHandle TagReplicationTimerHandle;
+
+	//
+	// Bytes of property updates written for this team info to all connections during the current one second window
+	//
+	int64 TagBytesInWindow{ 0 };
+	double TagBytesWindowStartTime{ 0.0 };
+	float TagBytesPerSecond{ 0.0f };
+
+	FTimerHandle TagBytesWindowTimerHandle;
+
+protected:
+	int32 FindTagReplicationPolicyIndex(const FGameplayTag& Tag);
+
+	void SetThrottledTagStack(const FGameplayTag& Tag, int32 PolicyIndex, int32 NewStackCount);
+	void ReplicateThrottledTagStack(const FGameplayTag& Tag, FThrottledTagStack& Entry, bool bExact);
+	void ScheduleTagReplication(double DueTime);
+	void HandleTagReplicationTimer();
+
+	void RecordTagReplication(int32 NumChanges);
+	void RecordReplicatedBytes(int64 Bytes);
+	void CloseTagBytesWindow();
+
+public:
+	/**
+	 * Adds a specified number of stacks to the tag (does nothing if StackCount is below 1)
+	 * 
+	 * Tips:
+	 *	Unlike changing the container from GetStatTags(), this follows TagReplicationPolicies
+	 */
+	void AddTeamTagStack(FGameplayTag Tag, int32 StackCount);
+
+	/**
+	 * Removes a specified number of stacks from the tag (does nothing if StackCount is below 1)
+	 */
+	void RemoveTeamTagStack(FGameplayTag Tag, int32 StackCount);
+
+	/**
+	 * Sets the stack count of the tag
+	 */
+	void SetTeamTagStack(FGameplayTag Tag, int32 StackCount);
+
+	/**
+	 * Returns the stack count of the tag, which on the server is the exact value even if it is not replicated yet
+	 */
+	int32 GetTeamTagStackCount(FGameplayTag Tag) const;
+
+	/**
+	 * Immediately replicate the exact stack counts of all tags with a policy
+	 * 
+	 * Tips:
+	 *	Call this when exact values must be visible to clients (e.g., at the end of a match)
+	 */
+	void FlushTeamTagStacks();
+
+	/**
+	 * Executes the function for each tag with its exact stack count and max stack count
+	 */
+	template<typename FuncType>
+	void ForEachTeamTagStack(FuncType&& Func) const
+	{
+		for (const auto& KVP : TeamTags.FastStacks)
+		{
+			const auto* Entry{ ThrottledTagStacks.Find(KVP.Key) };
+			Func(KVP.Key, Entry ? Entry->StackCount : KVP.Value.StackCount, KVP.Value.MaxStackCount);
+		}
+
+		for (const auto& KVP : ThrottledTagStacks)
+		{
+			if (!TeamTags.FastStacks.Contains(KVP.Key))
+			{
+				Func(KVP.Key, KVP.Value.StackCount, 0);
+			}
+		}
+	}
+
+	/**
+	 * Returns the bytes per second of property updates sent for this team info to all connections, measured over the last second
+	 * 
+	 * Note:
+	 *	TeamTags is the only property of a team info that changes during play, so this is the cost of team tag changes.
+	 *	It is measured from the actor channel, so it stays 0 when Iris replication is used
+	 */
+	float GetTagReplicationBytesPerSecond() const { return TagBytesPerSecond; }
+
+
 protected:
 	UPROPERTY(ReplicatedUsing = OnRep_TeamId)
 	int32 TeamId{ INDEX_NONE };
@@ -73,6 +201,11 @@ public:
 	 */
 	void SetTeamId(int32 NewTeamId);
 
+	/**
+	 * Returns which connections this TeamInfo is replicated to when team scoped replication is used
+	 */
+	virtual ETeamReplicationPolicy GetTeamReplicationPolicy() const { return ETeamReplicationPolicy::PublicToAll; }
+
 	////////////////////////////////////////////////////
 	// Game Mode Option
 public:
@@ -2,10 +2,30 @@
 
 #include "TeamInfo_Private.h"
 
+#include "TeamManagerSubsystem.h"
+#include "TeamFunctionLibrary.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(TeamInfo_Private)
 
 
 ATeamInfo_Private::ATeamInfo_Private(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
+	bAlwaysRelevant = false;
+}
+
+bool ATeamInfo_Private::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (TeamId == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) };
+	if (!TMS)
+	{
+		return false;
+	}
+
+	return TMS->FindViewerTeam(RealViewer) == UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId);
 }
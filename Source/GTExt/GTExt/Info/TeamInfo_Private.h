@@ -11,7 +11,8 @@
  * Class that stores private information about the team
  *
  * Tips:
- *	Information stored in this class cannot be seen by other teams
+ *	Information stored in this class cannot be seen by other teams,
+ *	as it is only relevant to connections whose player state is on this team
  */
 UCLASS()
 class GTEXT_API ATeamInfo_Private : public ATeamInfoBase
@@ -20,4 +21,8 @@ class GTEXT_API ATeamInfo_Private : public ATeamInfoBase
 public:
 	ATeamInfo_Private(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
+public:
+	virtual ETeamReplicationPolicy GetTeamReplicationPolicy() const override { return ETeamReplicationPolicy::TeamOnly; }
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 };
@@ -0,0 +1,254 @@
+// Copyright (C) 2024 owoDra
+
+#include "ReplicationGraphNode_TeamScoped.h"
+
+#include "TeamManagerSubsystem.h"
+
+#include "Engine/World.h"
+#include "Engine/NetConnection.h"
+#include "Engine/ChildConnection.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(ReplicationGraphNode_TeamScoped)
+
+
+UReplicationGraphNode_TeamScoped::UReplicationGraphNode_TeamScoped()
+{
+	bRequiresPrepareForReplicationCall = true;
+}
+
+
+UTeamManagerSubsystem* UReplicationGraphNode_TeamScoped::GetTeamManagerSubsystem()
+{
+	if (auto* TMS{ TeamManagerSubsystem.Get() })
+	{
+		return TMS;
+	}
+
+	auto* World{ GraphGlobals.IsValid() ? GraphGlobals->World : nullptr };
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(World) };
+
+	// Listen for team changes to move actors between the team lists
+
+	if (TMS)
+	{
+		TeamManagerSubsystem = TMS;
+		TeamMembersChangedHandle = TMS->OnTeamMembersChangedNative.AddUObject(this, &ThisClass::HandleTeamMembersChanged);
+	}
+
+	return TMS;
+}
+
+void UReplicationGraphNode_TeamScoped::LinkActor(FActorRepListType Actor, const FTrackedActor& Tracked)
+{
+	if (Tracked.Policy == ETeamReplicationPolicy::PublicToAll)
+	{
+		PublicActors.Add(Actor);
+	}
+	else if (Tracked.TeamId == FGenericTeamId::NoTeam)
+	{
+		UnresolvedActors.Add(Actor);
+	}
+	else if (Tracked.Policy == ETeamReplicationPolicy::TeamOnly)
+	{
+		TeamOnlyActors[Tracked.TeamId.GetId()].Add(Actor);
+	}
+	else
+	{
+		AlliesOnlyActors[Tracked.TeamId.GetId()].Add(Actor);
+	}
+}
+
+void UReplicationGraphNode_TeamScoped::UnlinkActor(FActorRepListType Actor, const FTrackedActor& Tracked)
+{
+	if (Tracked.Policy == ETeamReplicationPolicy::PublicToAll)
+	{
+		PublicActors.RemoveFast(Actor);
+	}
+	else if (Tracked.TeamId == FGenericTeamId::NoTeam)
+	{
+		UnresolvedActors.RemoveSingleSwap(Actor, /*bAllowShrinking*/ false);
+	}
+	else if (Tracked.Policy == ETeamReplicationPolicy::TeamOnly)
+	{
+		TeamOnlyActors[Tracked.TeamId.GetId()].RemoveFast(Actor);
+	}
+	else
+	{
+		AlliesOnlyActors[Tracked.TeamId.GetId()].RemoveFast(Actor);
+	}
+}
+
+void UReplicationGraphNode_TeamScoped::RefreshActor(FActorRepListType Actor)
+{
+	auto* Tracked{ TrackedActors.Find(Actor) };
+	auto* TMS{ GetTeamManagerSubsystem() };
+
+	if (!Tracked || !TMS)
+	{
+		return;
+	}
+
+	FTrackedActor NewTracked;
+	NewTracked.Policy = TMS->GetActorReplicationPolicy(Actor, NewTracked.TeamId);
+
+	if ((NewTracked.Policy != Tracked->Policy) || (NewTracked.TeamId != Tracked->TeamId))
+	{
+		UnlinkActor(Actor, *Tracked);
+		*Tracked = NewTracked;
+		LinkActor(Actor, *Tracked);
+	}
+}
+
+
+void UReplicationGraphNode_TeamScoped::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	auto* Actor{ ActorInfo.Actor };
+
+	if (!Actor || TrackedActors.Contains(Actor))
+	{
+		return;
+	}
+
+	FTrackedActor Tracked;
+
+	if (auto* TMS{ GetTeamManagerSubsystem() })
+	{
+		Tracked.Policy = TMS->GetActorReplicationPolicy(Actor, Tracked.TeamId);
+	}
+
+	TrackedActors.Add(Actor, Tracked);
+	LinkActor(Actor, Tracked);
+}
+
+bool UReplicationGraphNode_TeamScoped::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	FTrackedActor Tracked;
+
+	if (!TrackedActors.RemoveAndCopyValue(ActorInfo.Actor, Tracked))
+	{
+		return false;
+	}
+
+	UnlinkActor(ActorInfo.Actor, Tracked);
+
+	return true;
+}
+
+void UReplicationGraphNode_TeamScoped::NotifyResetAllNetworkActors()
+{
+	TrackedActors.Reset();
+	PublicActors.Reset();
+	UnresolvedActors.Reset();
+	OwnerUnresolvedActors.Reset();
+
+	for (auto Index{ 0 }; Index < MaxTeams; ++Index)
+	{
+		TeamOnlyActors[Index].Reset();
+		AlliesOnlyActors[Index].Reset();
+	}
+
+	if (auto* TMS{ TeamManagerSubsystem.Get() })
+	{
+		TMS->OnTeamMembersChangedNative.Remove(TeamMembersChangedHandle);
+	}
+
+	TeamManagerSubsystem.Reset();
+	TeamMembersChangedHandle.Reset();
+}
+
+void UReplicationGraphNode_TeamScoped::PrepareForReplication()
+{
+	// Team infos get their team after they start replicating, so resolve them once it is known
+
+	for (auto Index{ UnresolvedActors.Num() - 1 }; Index >= 0; --Index)
+	{
+		RefreshActor(UnresolvedActors[Index]);
+	}
+
+	// The rest is replicated to the owning connection so that login and possession are not stalled
+
+	OwnerUnresolvedActors.Reset();
+
+	for (const auto& Actor : UnresolvedActors)
+	{
+		auto* Connection{ Actor->GetNetConnection() };
+
+		if (auto* ChildConnection{ Connection ? Connection->GetUChildConnection() : nullptr })
+		{
+			Connection = ChildConnection->Parent;
+		}
+
+		if (Connection)
+		{
+			OwnerUnresolvedActors.FindOrAdd(Connection).Add(Actor);
+		}
+	}
+}
+
+void UReplicationGraphNode_TeamScoped::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	if (PublicActors.Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(PublicActors);
+	}
+
+	if (const auto* OwnedActors{ OwnerUnresolvedActors.Find(Params.ConnectionManager.NetConnection) }; OwnedActors && (OwnedActors->Num() > 0))
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(*OwnedActors);
+	}
+
+	auto* TMS{ GetTeamManagerSubsystem() };
+	if (!TMS)
+	{
+		return;
+	}
+
+	// Gather the lists of each team of the viewers of the connection (more than one with split screen)
+
+	uint64 GatheredTeamOnly[MaxTeams / 64]{ 0 };
+	uint64 GatheredAlliesOnly[MaxTeams / 64]{ 0 };
+
+	auto TryGather
+	{
+		[&Params](FActorRepListRefView& List, uint64* Gathered, int32 TeamId)
+		{
+			auto& Word{ Gathered[TeamId >> 6] };
+			const auto Bit{ 1ull << (TeamId & 63) };
+
+			if (((Word & Bit) == 0) && (List.Num() > 0))
+			{
+				Params.OutGatheredReplicationLists.AddReplicationActorList(List);
+			}
+
+			Word |= Bit;
+		}
+	};
+
+	for (const auto& Viewer : Params.Viewers)
+	{
+		const auto ViewerTeamId{ TMS->FindViewerTeam(Viewer.InViewer) };
+		if (ViewerTeamId == FGenericTeamId::NoTeam)
+		{
+			continue;
+		}
+
+		const auto TeamId{ static_cast<int32>(ViewerTeamId.GetId()) };
+
+		TryGather(TeamOnlyActors[TeamId], GatheredTeamOnly, TeamId);
+		TryGather(AlliesOnlyActors[TeamId], GatheredAlliesOnly, TeamId);
+
+		for (const auto& AllyTeamId : TMS->GetAllyTeamIDs(TeamId))
+		{
+			TryGather(AlliesOnlyActors[AllyTeamId], GatheredAlliesOnly, AllyTeamId);
+		}
+	}
+}
+
+
+void UReplicationGraphNode_TeamScoped::HandleTeamMembersChanged(TConstArrayView<FTeamMemberChangeRecord> Records)
+{
+	for (const auto& Record : Records)
+	{
+		RefreshActor(Record.Actor);
+	}
+}
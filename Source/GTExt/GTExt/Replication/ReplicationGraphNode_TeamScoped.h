@@ -0,0 +1,94 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "ReplicationGraph.h"
+
+#include "GenericTeamAgentInterface.h"
+
+#include "Replication/TeamReplicationPolicy.h"
+#include "TeamMemberChangeRecord.h"
+
+#include "ReplicationGraphNode_TeamScoped.generated.h"
+
+class UTeamManagerSubsystem;
+
+
+/**
+ * Replication graph node that routes team scoped actors to connections by team membership
+ * 
+ * Tips:
+ *	Actors are kept in one list per team and policy, and a connection only gathers the lists of its own team
+ *	(and of friendly teams for AlliesOnly actors), so the cost per connection does not depend on the actors of other teams.
+ *	The policy and team of each actor are resolved by UTeamManagerSubsystem::GetActorReplicationPolicy(),
+ *	so team infos and actors with UTeamMemberComponent can be routed to this node from UReplicationGraph::RouteAddNetworkActorToNodes().
+ *	Team scoped actors without a team are only replicated to their owning connection until their team is known
+ */
+UCLASS()
+class GTEXT_API UReplicationGraphNode_TeamScoped : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+public:
+	UReplicationGraphNode_TeamScoped();
+
+	//
+	// Number of team IDs that can be represented by FGenericTeamId
+	//
+	static constexpr int32 MaxTeams{ 256 };
+
+public:
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void PrepareForReplication() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+protected:
+	struct FTrackedActor
+	{
+	public:
+		ETeamReplicationPolicy Policy{ ETeamReplicationPolicy::PublicToAll };
+
+		FGenericTeamId TeamId{ FGenericTeamId::NoTeam };
+	};
+
+	TMap<FActorRepListType, FTrackedActor> TrackedActors;
+
+	//
+	// Actors replicated to every connection
+	//
+	FActorRepListRefView PublicActors;
+
+	//
+	// TeamOnly and AlliesOnly actors of each team
+	//
+	FActorRepListRefView TeamOnlyActors[MaxTeams];
+	FActorRepListRefView AlliesOnlyActors[MaxTeams];
+
+	//
+	// Team scoped actors whose team is not known yet, replicated only to their owning connection until it is
+	//
+	TArray<FActorRepListType> UnresolvedActors;
+
+	//
+	// Unresolved actors of each owning connection, rebuilt every frame since owners may change (e.g., on possession)
+	//
+	TMap<UNetConnection*, FActorRepListRefView> OwnerUnresolvedActors;
+
+	TWeakObjectPtr<UTeamManagerSubsystem> TeamManagerSubsystem;
+	FDelegateHandle TeamMembersChangedHandle;
+
+protected:
+	UTeamManagerSubsystem* GetTeamManagerSubsystem();
+
+	void LinkActor(FActorRepListType Actor, const FTrackedActor& Tracked);
+	void UnlinkActor(FActorRepListType Actor, const FTrackedActor& Tracked);
+
+	/**
+	 * Resolve the policy and team of the actor again and move it to the matching list
+	 */
+	void RefreshActor(FActorRepListType Actor);
+
+	void HandleTeamMembersChanged(TConstArrayView<FTeamMemberChangeRecord> Records);
+
+};
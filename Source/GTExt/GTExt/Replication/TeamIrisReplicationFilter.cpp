@@ -0,0 +1,397 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamIrisReplicationFilter.h"
+
+#include "TeamManagerSubsystem.h"
+
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+
+#if UE_WITH_IRIS
+#include "Iris/ReplicationSystem/ReplicationSystem.h"
+#include "Net/Iris/ReplicationSystem/ActorReplicationBridge.h"
+#include "Misc/EngineVersionComparison.h"
+#endif
+
+
+#if UE_WITH_IRIS
+
+bool FTeamIrisReplicationFilter::Init(UTeamManagerSubsystem* InOwner, UWorld* World)
+{
+	Deinit();
+
+	auto* NetDriver{ World ? World->GetNetDriver() : nullptr };
+	if (!NetDriver || !NetDriver->IsServer() || !NetDriver->IsUsingIrisReplication())
+	{
+		return false;
+	}
+
+	Owner = InOwner;
+	ReplicationSystem = NetDriver->GetReplicationSystem();
+
+	return IsActive();
+}
+
+void FTeamIrisReplicationFilter::Deinit()
+{
+	if (auto* System{ ReplicationSystem.Get() })
+	{
+		auto DestroyGroup
+		{
+			[System](FTeamGroup& Group)
+			{
+				if (Group.bCreated)
+				{
+					System->DestroyGroup(Group.Handle);
+				}
+			}
+		};
+
+		for (auto& Group : TeamOnlyGroups)
+		{
+			DestroyGroup(Group);
+		}
+
+		for (auto& Group : AlliesOnlyGroups)
+		{
+			DestroyGroup(Group);
+		}
+
+		DestroyGroup(NoTeamGroup);
+
+		for (auto& KVP : OwnerGroups)
+		{
+			DestroyGroup(KVP.Value);
+		}
+
+		for (auto& Group : ClosedOwnerGroups)
+		{
+			DestroyGroup(Group);
+		}
+	}
+
+	for (auto& Group : TeamOnlyGroups)
+	{
+		Group = FTeamGroup();
+	}
+
+	for (auto& Group : AlliesOnlyGroups)
+	{
+		Group = FTeamGroup();
+	}
+
+	NoTeamGroup = FTeamGroup();
+	OwnerGroups.Reset();
+	ClosedOwnerGroups.Reset();
+
+	Actors.Reset();
+	PendingActors.Reset();
+	UnresolvedActors.Reset();
+	ConnectionTeams.Reset();
+
+	ReplicationSystem.Reset();
+	Owner = nullptr;
+}
+
+
+FTeamIrisReplicationFilter::FTeamGroup& FTeamIrisReplicationFilter::GetOrCreateGroup(ETeamReplicationPolicy Policy, FGenericTeamId TeamId)
+{
+	auto& Group
+	{
+		(TeamId == FGenericTeamId::NoTeam) ? NoTeamGroup :
+		(Policy == ETeamReplicationPolicy::AlliesOnly) ? AlliesOnlyGroups[TeamId.GetId()] : TeamOnlyGroups[TeamId.GetId()]
+	};
+
+	if (!Group.bCreated)
+	{
+		auto* System{ ReplicationSystem.Get() };
+		check(System);
+
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+		Group.Handle = System->CreateGroup();
+#else
+		Group.Handle = System->CreateGroup(NAME_None);
+#endif
+		Group.bCreated = true;
+
+		// Exclusion groups are not replicated to any connection until it is allowed
+
+		System->AddExclusionFilterGroup(Group.Handle);
+
+		if (TeamId != FGenericTeamId::NoTeam)
+		{
+			for (const auto& KVP : ConnectionTeams)
+			{
+				RefreshGroupStatus(Group, Policy, TeamId, KVP.Key, KVP.Value);
+			}
+		}
+	}
+
+	return Group;
+}
+
+FTeamIrisReplicationFilter::FTeamGroup& FTeamIrisReplicationFilter::GetOrCreateOwnerGroup(uint32 ConnectionId)
+{
+	auto& Group{ OwnerGroups.FindOrAdd(ConnectionId) };
+
+	if (!Group.bCreated)
+	{
+		auto* System{ ReplicationSystem.Get() };
+		check(System);
+
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+		Group.Handle = System->CreateGroup();
+#else
+		Group.Handle = System->CreateGroup(NAME_None);
+#endif
+		Group.bCreated = true;
+
+		System->AddExclusionFilterGroup(Group.Handle);
+		System->SetGroupFilterStatus(Group.Handle, ConnectionId, UE::Net::ENetFilterStatus::Allow);
+	}
+
+	return Group;
+}
+
+uint32 FTeamIrisReplicationFilter::GetOwnerConnectionId(const AActor* Actor)
+{
+	// Iris connection IDs start from 1, so 0 means the actor has no owning connection
+
+	const auto* Connection{ Actor ? Actor->GetNetConnection() : nullptr };
+	return Connection ? Connection->GetConnectionId() : 0;
+}
+
+void FTeamIrisReplicationFilter::RefreshGroupStatus(const FTeamGroup& Group, ETeamReplicationPolicy Policy, FGenericTeamId GroupTeamId, uint32 ConnectionId, FGenericTeamId ConnectionTeamId)
+{
+	if (Group.bCreated)
+	{
+		const auto bAllowed{ Owner->IsReplicatedToViewerTeam(ConnectionTeamId, GroupTeamId, Policy) };
+
+		ReplicationSystem->SetGroupFilterStatus(Group.Handle, ConnectionId, bAllowed ? UE::Net::ENetFilterStatus::Allow : UE::Net::ENetFilterStatus::Disallow);
+	}
+}
+
+
+bool FTeamIrisReplicationFilter::LinkActor(AActor* Actor, FActorScope& Scope)
+{
+	auto* Bridge{ ReplicationSystem->GetReplicationBridgeAs<UActorReplicationBridge>() };
+	const auto Handle{ Bridge ? Bridge->GetReplicatedRefHandle(Actor) : UE::Net::FNetRefHandle() };
+
+	if (!Handle.IsValid())
+	{
+		return false;
+	}
+
+	if (Scope.Policy != ETeamReplicationPolicy::PublicToAll)
+	{
+		// Actors without a team are still replicated to their owner so that login and possession are not stalled
+
+		Scope.OwnerConnectionId = (Scope.TeamId == FGenericTeamId::NoTeam) ? GetOwnerConnectionId(Actor) : 0;
+
+		const auto& Group{ (Scope.OwnerConnectionId != 0) ? GetOrCreateOwnerGroup(Scope.OwnerConnectionId) : GetOrCreateGroup(Scope.Policy, Scope.TeamId) };
+
+		ReplicationSystem->AddToGroup(Group.Handle, Handle);
+
+		Scope.Handle = Handle;
+		Scope.Group = Group.Handle;
+		Scope.bInGroup = true;
+	}
+
+	return true;
+}
+
+void FTeamIrisReplicationFilter::UnlinkActor(FActorScope& Scope)
+{
+	if (Scope.bInGroup)
+	{
+		ReplicationSystem->RemoveFromGroup(Scope.Group, Scope.Handle);
+
+		Scope.bInGroup = false;
+	}
+}
+
+
+void FTeamIrisReplicationFilter::SetActorScope(AActor* Actor, ETeamReplicationPolicy Policy, FGenericTeamId TeamId)
+{
+	if (!IsActive() || !Actor)
+	{
+		return;
+	}
+
+	auto& Scope{ Actors.FindOrAdd(Actor) };
+
+	if (Scope.bInGroup && (Scope.Policy == Policy) && (Scope.TeamId == TeamId))
+	{
+		return;
+	}
+
+	UnlinkActor(Scope);
+
+	Scope.Policy = Policy;
+	Scope.TeamId = TeamId;
+
+	// The actor may not be replicated yet (e.g., while it is being registered), so try again later
+
+	if (LinkActor(Actor, Scope))
+	{
+		PendingActors.Remove(Actor);
+	}
+	else
+	{
+		PendingActors.Add(Actor);
+	}
+
+	if ((Policy != ETeamReplicationPolicy::PublicToAll) && (TeamId == FGenericTeamId::NoTeam))
+	{
+		UnresolvedActors.Add(Actor);
+	}
+	else
+	{
+		UnresolvedActors.Remove(Actor);
+	}
+}
+
+void FTeamIrisReplicationFilter::RemoveActor(AActor* Actor)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	if (auto* Scope{ Actors.Find(Actor) })
+	{
+		UnlinkActor(*Scope);
+
+		Actors.Remove(Actor);
+	}
+
+	PendingActors.Remove(Actor);
+	UnresolvedActors.Remove(Actor);
+}
+
+void FTeamIrisReplicationFilter::SetConnectionTeam(uint32 ConnectionId, FGenericTeamId TeamId)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	ConnectionTeams.Add(ConnectionId, TeamId);
+
+	for (auto Index{ 0 }; Index < MaxTeams; ++Index)
+	{
+		const FGenericTeamId GroupTeamId{ static_cast<uint8>(Index) };
+
+		RefreshGroupStatus(TeamOnlyGroups[Index], ETeamReplicationPolicy::TeamOnly, GroupTeamId, ConnectionId, TeamId);
+		RefreshGroupStatus(AlliesOnlyGroups[Index], ETeamReplicationPolicy::AlliesOnly, GroupTeamId, ConnectionId, TeamId);
+	}
+}
+
+void FTeamIrisReplicationFilter::RemoveConnection(uint32 ConnectionId)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	ConnectionTeams.Remove(ConnectionId);
+
+	for (auto Index{ 0 }; Index < MaxTeams; ++Index)
+	{
+		for (const auto* Group : { &TeamOnlyGroups[Index], &AlliesOnlyGroups[Index] })
+		{
+			if (Group->bCreated)
+			{
+				ReplicationSystem->SetGroupFilterStatus(Group->Handle, ConnectionId, UE::Net::ENetFilterStatus::Disallow);
+			}
+		}
+	}
+
+	// A later connection with the same ID gets a new owner group
+
+	FTeamGroup OwnerGroup;
+
+	if (OwnerGroups.RemoveAndCopyValue(ConnectionId, OwnerGroup) && OwnerGroup.bCreated)
+	{
+		ReplicationSystem->SetGroupFilterStatus(OwnerGroup.Handle, ConnectionId, UE::Net::ENetFilterStatus::Disallow);
+
+		ClosedOwnerGroups.Add(OwnerGroup);
+	}
+}
+
+void FTeamIrisReplicationFilter::RefreshAlliances()
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	for (auto Index{ 0 }; Index < MaxTeams; ++Index)
+	{
+		const auto& Group{ AlliesOnlyGroups[Index] };
+
+		if (Group.bCreated)
+		{
+			for (const auto& KVP : ConnectionTeams)
+			{
+				RefreshGroupStatus(Group, ETeamReplicationPolicy::AlliesOnly, FGenericTeamId(static_cast<uint8>(Index)), KVP.Key, KVP.Value);
+			}
+		}
+	}
+}
+
+void FTeamIrisReplicationFilter::ProcessPendingActors()
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	for (auto It{ PendingActors.CreateIterator() }; It; ++It)
+	{
+		auto* Actor{ It->ResolveObjectPtr() };
+		auto* Scope{ Actor ? Actors.Find(*It) : nullptr };
+
+		if (!Scope)
+		{
+			Actors.Remove(*It);
+			It.RemoveCurrent();
+		}
+		else if (LinkActor(Actor, *Scope))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Actors without a team follow their owner (e.g., a pawn being possessed)
+
+	for (auto It{ UnresolvedActors.CreateIterator() }; It; ++It)
+	{
+		auto* Actor{ It->ResolveObjectPtr() };
+		auto* Scope{ Actor ? Actors.Find(*It) : nullptr };
+
+		if (!Scope)
+		{
+			It.RemoveCurrent();
+		}
+		else if (Scope->bInGroup && (Scope->OwnerConnectionId != GetOwnerConnectionId(Actor)))
+		{
+			UnlinkActor(*Scope);
+			LinkActor(Actor, *Scope);
+		}
+	}
+}
+
+#else
+
+bool FTeamIrisReplicationFilter::Init(UTeamManagerSubsystem* InOwner, UWorld* World) { return false; }
+void FTeamIrisReplicationFilter::Deinit() {}
+void FTeamIrisReplicationFilter::SetActorScope(AActor* Actor, ETeamReplicationPolicy Policy, FGenericTeamId TeamId) {}
+void FTeamIrisReplicationFilter::RemoveActor(AActor* Actor) {}
+void FTeamIrisReplicationFilter::SetConnectionTeam(uint32 ConnectionId, FGenericTeamId TeamId) {}
+void FTeamIrisReplicationFilter::RemoveConnection(uint32 ConnectionId) {}
+void FTeamIrisReplicationFilter::RefreshAlliances() {}
+void FTeamIrisReplicationFilter::ProcessPendingActors() {}
+
+#endif
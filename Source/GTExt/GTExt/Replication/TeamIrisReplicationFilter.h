@@ -0,0 +1,156 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GenericTeamAgentInterface.h"
+
+#include "Replication/TeamReplicationPolicy.h"
+
+#if UE_WITH_IRIS
+#include "Iris/ReplicationSystem/ReplicationSystem.h"
+#endif
+
+class AActor;
+class UWorld;
+class UReplicationSystem;
+class UTeamManagerSubsystem;
+
+
+/**
+ * Iris filtering that routes team scoped actors to connections by team membership
+ *
+ * Tips:
+ *	Each team has one exclusion filter group for its TeamOnly actors and one for its AlliesOnly actors.
+ *	Connections are allowed into the groups of their own team (and of friendly teams for AlliesOnly),
+ *	so Iris filters per group and a team change only updates the groups of one connection.
+ *	Team scoped actors without a team are put in a group that only their owning connection is allowed into,
+ *	so a player state or pawn still reaches its own client before a team is assigned
+ */
+class GTEXT_API FTeamIrisReplicationFilter
+{
+public:
+	FTeamIrisReplicationFilter() {}
+
+	//
+	// Number of team IDs that can be represented by FGenericTeamId
+	//
+	static constexpr int32 MaxTeams{ 256 };
+
+	/**
+	 * Start filtering if the world replicates with Iris, returns true if filtering is active
+	 */
+	bool Init(UTeamManagerSubsystem* InOwner, UWorld* World);
+
+	/**
+	 * Stop filtering and destroy the created groups
+	 */
+	void Deinit();
+
+	/**
+	 * Set which connections the actor is replicated to
+	 */
+	void SetActorScope(AActor* Actor, ETeamReplicationPolicy Policy, FGenericTeamId TeamId);
+
+	/**
+	 * Stop filtering the actor
+	 */
+	void RemoveActor(AActor* Actor);
+
+	/**
+	 * Set the team of the player on the connection
+	 */
+	void SetConnectionTeam(uint32 ConnectionId, FGenericTeamId TeamId);
+
+	/**
+	 * Disallow the closed connection from all groups, since Iris reuses its ID for later connections
+	 */
+	void RemoveConnection(uint32 ConnectionId);
+
+	/**
+	 * Update the connections allowed into AlliesOnly groups after the attitudes between teams have changed
+	 */
+	void RefreshAlliances();
+
+	/**
+	 * Add actors that were not replicated yet when their scope was set
+	 */
+	void ProcessPendingActors();
+
+#if UE_WITH_IRIS
+	FORCEINLINE bool IsActive() const { return ReplicationSystem.IsValid(); }
+	FORCEINLINE bool HasPendingActors() const { return !PendingActors.IsEmpty() || !UnresolvedActors.IsEmpty(); }
+
+protected:
+	struct FActorScope
+	{
+	public:
+		ETeamReplicationPolicy Policy{ ETeamReplicationPolicy::PublicToAll };
+
+		FGenericTeamId TeamId{ FGenericTeamId::NoTeam };
+
+		//
+		// Handle and group of the actor while it is in a group
+		//
+		UE::Net::FNetRefHandle Handle;
+		UE::Net::FNetObjectGroupHandle Group;
+
+		//
+		// Owning connection the actor was grouped by while it has no team
+		//
+		uint32 OwnerConnectionId{ 0 };
+
+		bool bInGroup{ false };
+	};
+
+	struct FTeamGroup
+	{
+	public:
+		UE::Net::FNetObjectGroupHandle Handle;
+
+		bool bCreated{ false };
+	};
+
+	UTeamManagerSubsystem* Owner{ nullptr };
+
+	TWeakObjectPtr<UReplicationSystem> ReplicationSystem;
+
+	TMap<TObjectKey<AActor>, FActorScope> Actors;
+	TSet<TObjectKey<AActor>> PendingActors;
+
+	//
+	// Team scoped actors without a team, checked for owner changes
+	//
+	TSet<TObjectKey<AActor>> UnresolvedActors;
+
+	FTeamGroup TeamOnlyGroups[MaxTeams];
+	FTeamGroup AlliesOnlyGroups[MaxTeams];
+	FTeamGroup NoTeamGroup;
+
+	//
+	// Group of the team scoped actors without a team for each owning connection, only allowed for that connection
+	//
+	TMap<uint32, FTeamGroup> OwnerGroups;
+
+	//
+	// Owner groups of closed connections, which may still hold actors of the connection until they are destroyed
+	//
+	TArray<FTeamGroup> ClosedOwnerGroups;
+
+	TMap<uint32, FGenericTeamId> ConnectionTeams;
+
+protected:
+	FTeamGroup& GetOrCreateGroup(ETeamReplicationPolicy Policy, FGenericTeamId TeamId);
+	FTeamGroup& GetOrCreateOwnerGroup(uint32 ConnectionId);
+
+	static uint32 GetOwnerConnectionId(const AActor* Actor);
+	void RefreshGroupStatus(const FTeamGroup& Group, ETeamReplicationPolicy Policy, FGenericTeamId GroupTeamId, uint32 ConnectionId, FGenericTeamId ConnectionTeamId);
+
+	bool LinkActor(AActor* Actor, FActorScope& Scope);
+	void UnlinkActor(FActorScope& Scope);
+
+#else
+	FORCEINLINE bool IsActive() const { return false; }
+	FORCEINLINE bool HasPendingActors() const { return false; }
+#endif
+
+};
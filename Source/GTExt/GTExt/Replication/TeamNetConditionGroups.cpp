@@ -0,0 +1,32 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamNetConditionGroups.h"
+
+
+FName FTeamNetConditionGroups::GetTeamGroupName(FGenericTeamId TeamId)
+{
+	if (TeamId == FGenericTeamId::NoTeam)
+	{
+		return NAME_None;
+	}
+
+	// Names are created once per team so lookups never touch the name table
+
+	static const auto GroupNames
+	{
+		[]()
+		{
+			TArray<FName> Names;
+			Names.Reserve(FGenericTeamId::NoTeam.GetId());
+
+			for (auto Id{ 0 }; Id < FGenericTeamId::NoTeam.GetId(); ++Id)
+			{
+				Names.Add(FName(TEXT("GTExt.Team"), NAME_EXTERNAL_TO_INTERNAL(Id)));
+			}
+
+			return Names;
+		}()
+	};
+
+	return GroupNames[TeamId.GetId()];
+}
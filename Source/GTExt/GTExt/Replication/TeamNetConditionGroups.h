@@ -0,0 +1,23 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GenericTeamAgentInterface.h"
+
+
+/**
+ * Net condition groups used to replicate subobjects only to the connections of a team
+ * 
+ * Tips:
+ *	Player controllers are included in the group of the team of their player state by UTeamManagerSubsystem,
+ *	so the engine resolves COND_NetGroup per connection without asking the team system per property
+ */
+class GTEXT_API FTeamNetConditionGroups
+{
+public:
+	/**
+	 * Returns the net condition group name of the team or NAME_None for no team
+	 */
+	static FName GetTeamGroupName(FGenericTeamId TeamId);
+
+};
@@ -0,0 +1,35 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamOnlyReplicatedObject.h"
+
+#include "TeamMemberComponent.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamOnlyReplicatedObject)
+
+
+UTeamOnlyReplicatedObject::UTeamOnlyReplicatedObject(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+UWorld* UTeamOnlyReplicatedObject::GetWorld() const
+{
+	if (HasAnyFlags(RF_ClassDefaultObject))
+	{
+		return nullptr;
+	}
+
+	const auto* Actor{ GetOwningActor() };
+	return Actor ? Actor->GetWorld() : nullptr;
+}
+
+
+UTeamMemberComponent* UTeamOnlyReplicatedObject::GetTeamMemberComponent() const
+{
+	return GetTypedOuter<UTeamMemberComponent>();
+}
+
+AActor* UTeamOnlyReplicatedObject::GetOwningActor() const
+{
+	return GetTypedOuter<AActor>();
+}
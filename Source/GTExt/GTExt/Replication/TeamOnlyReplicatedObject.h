@@ -0,0 +1,45 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "UObject/Object.h"
+
+#include "TeamOnlyReplicatedObject.generated.h"
+
+class UTeamMemberComponent;
+
+
+/**
+ * Base class of replicated subobjects whose properties are replicated only to the team of their owner
+ * 
+ * Tips:
+ *	Subclass this with the properties that only teammates should receive (e.g., ammo, cooldowns, ping markers)
+ *	and add the instance with UTeamMemberComponent::AddTeamOnlySubObject()
+ * 
+ * Note:
+ *	The owning actor must replicate using the registered subobject list (bReplicateUsingRegisteredSubObjectList)
+ */
+UCLASS(Abstract, Blueprintable, BlueprintType, DefaultToInstanced, EditInlineNew)
+class GTEXT_API UTeamOnlyReplicatedObject : public UObject
+{
+	GENERATED_BODY()
+public:
+	UTeamOnlyReplicatedObject(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual bool IsSupportedForNetworking() const override { return true; }
+	virtual UWorld* GetWorld() const override;
+
+public:
+	/**
+	 * Returns the team member component that this object was created for
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Team")
+	UTeamMemberComponent* GetTeamMemberComponent() const;
+
+	/**
+	 * Returns the actor that replicates this object
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Team")
+	AActor* GetOwningActor() const;
+
+};
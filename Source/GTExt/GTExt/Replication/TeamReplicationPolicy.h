@@ -0,0 +1,22 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "TeamReplicationPolicy.generated.h"
+
+
+/**
+ * Which connections a team scoped actor is replicated to
+ * 
+ * Tips:
+ *	Used by UReplicationGraphNode_TeamScoped and by the Iris filter groups of UTeamManagerSubsystem
+ */
+UENUM(BlueprintType)
+enum class ETeamReplicationPolicy : uint8
+{
+	PublicToAll,	// Replicated to every connection
+
+	TeamOnly,		// Replicated only to connections whose player state is on the same team
+
+	AlliesOnly		// Replicated to connections whose player state is on the same team or a team friendly to it
+};
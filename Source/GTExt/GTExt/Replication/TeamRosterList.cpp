@@ -0,0 +1,126 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamRosterList.h"
+
+#include "TeamManagerSubsystem.h"
+
+#include "GameFramework/PlayerState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamRosterList)
+
+
+// FTeamRosterEntry
+
+void FTeamRosterEntry::PreReplicatedRemove(const FTeamRosterList& InArraySerializer)
+{
+	InArraySerializer.RemoveEntry(*this);
+}
+
+void FTeamRosterEntry::PostReplicatedAdd(const FTeamRosterList& InArraySerializer)
+{
+	InArraySerializer.ApplyEntry(*this);
+}
+
+void FTeamRosterEntry::PostReplicatedChange(const FTeamRosterList& InArraySerializer)
+{
+	InArraySerializer.ApplyEntry(*this);
+}
+
+
+// FTeamRosterList
+
+UTeamManagerSubsystem* FTeamRosterList::GetTeamManagerSubsystem() const
+{
+	return Owner ? UWorld::GetSubsystem<UTeamManagerSubsystem>(Owner->GetWorld()) : nullptr;
+}
+
+void FTeamRosterList::ApplyEntry(FTeamRosterEntry& Entry) const
+{
+	auto* TMS{ GetTeamManagerSubsystem() };
+	if (!TMS)
+	{
+		return;
+	}
+
+	// The entry may now point to another player state when the pointer has been resolved or the entry reused
+
+	if (auto* OldPlayerState{ Entry.AppliedPlayerState.Get() }; OldPlayerState && (OldPlayerState != Entry.PlayerState))
+	{
+		TMS->SetPlayerRosterTeam(OldPlayerState, FGenericTeamId::NoTeam);
+	}
+
+	Entry.AppliedPlayerState = Entry.PlayerState;
+
+	if (Entry.PlayerState)
+	{
+		TMS->SetPlayerRosterTeam(Entry.PlayerState, Entry.TeamId);
+	}
+}
+
+void FTeamRosterList::RemoveEntry(FTeamRosterEntry& Entry) const
+{
+	auto* TMS{ GetTeamManagerSubsystem() };
+	auto* PlayerState{ Entry.AppliedPlayerState.Get() };
+
+	if (TMS && PlayerState)
+	{
+		TMS->SetPlayerRosterTeam(PlayerState, FGenericTeamId::NoTeam);
+	}
+
+	Entry.AppliedPlayerState.Reset();
+}
+
+
+void FTeamRosterList::SetPlayerTeam(APlayerState* PlayerState, FGenericTeamId TeamId)
+{
+	if (!PlayerState)
+	{
+		return;
+	}
+
+	const auto* IndexPtr{ EntryIndices.Find(PlayerState) };
+	const auto Index{ IndexPtr ? *IndexPtr : INDEX_NONE };
+
+	if (TeamId == FGenericTeamId::NoTeam)
+	{
+		if (Index != INDEX_NONE)
+		{
+			EntryIndices.Remove(PlayerState);
+			Entries.RemoveAtSwap(Index, 1, /*bAllowShrinking*/ false);
+
+			// The last entry has been moved into the removed slot
+
+			if (Entries.IsValidIndex(Index))
+			{
+				EntryIndices.Add(Entries[Index].PlayerState, Index);
+			}
+
+			MarkArrayDirty();
+		}
+	}
+	else if (Index != INDEX_NONE)
+	{
+		auto& Entry{ Entries[Index] };
+
+		if (Entry.TeamId != TeamId)
+		{
+			Entry.TeamId = TeamId;
+			MarkItemDirty(Entry);
+		}
+	}
+	else
+	{
+		EntryIndices.Add(PlayerState, Entries.Num());
+		MarkItemDirty(Entries.Emplace_GetRef(PlayerState, TeamId));
+	}
+}
+
+void FTeamRosterList::Reset()
+{
+	if (!Entries.IsEmpty())
+	{
+		Entries.Reset();
+		EntryIndices.Reset();
+		MarkArrayDirty();
+	}
+}
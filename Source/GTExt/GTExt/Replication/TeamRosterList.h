@@ -0,0 +1,115 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Net/Serialization/FastArraySerializer.h"
+#include "GenericTeamAgentInterface.h"
+
+#include "TeamRosterList.generated.h"
+
+class APlayerState;
+class UTeamManagerSubsystem;
+struct FTeamRosterList;
+
+
+/**
+ * Entry of the replicated team roster
+ */
+USTRUCT(BlueprintType)
+struct FTeamRosterEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+public:
+	FTeamRosterEntry() {}
+
+	FTeamRosterEntry(APlayerState* InPlayerState, FGenericTeamId InTeamId)
+		: PlayerState(InPlayerState), TeamId(InTeamId)
+	{}
+
+public:
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<APlayerState> PlayerState{ nullptr };
+
+	UPROPERTY(BlueprintReadOnly)
+	FGenericTeamId TeamId{ FGenericTeamId::NoTeam };
+
+	//
+	// Player state last applied to the client side index, as the replicated pointer may be resolved later
+	//
+	UPROPERTY(NotReplicated)
+	TWeakObjectPtr<APlayerState> AppliedPlayerState;
+
+public:
+	void PreReplicatedRemove(const FTeamRosterList& InArraySerializer);
+	void PostReplicatedAdd(const FTeamRosterList& InArraySerializer);
+	void PostReplicatedChange(const FTeamRosterList& InArraySerializer);
+
+};
+
+
+/**
+ * Team roster of all player states replicated as a single delta serialized array
+ * 
+ * Tips:
+ *	Clients receive the full membership table through one channel, even for player states and pawns that are not relevant,
+ *	and feed it into the player roster of UTeamManagerSubsystem
+ */
+USTRUCT(BlueprintType)
+struct FTeamRosterList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	friend struct FTeamRosterEntry;
+
+public:
+	FTeamRosterList() {}
+
+	FTeamRosterList(UObject* InOwner) : Owner(InOwner) {}
+
+protected:
+	UPROPERTY()
+	TArray<FTeamRosterEntry> Entries;
+
+	UPROPERTY(NotReplicated)
+	TObjectPtr<UObject> Owner{ nullptr };
+
+	//
+	// Index of the entry of each player state, only maintained on the server
+	//
+	TMap<TObjectKey<APlayerState>, int32> EntryIndices;
+
+protected:
+	UTeamManagerSubsystem* GetTeamManagerSubsystem() const;
+
+	void ApplyEntry(FTeamRosterEntry& Entry) const;
+	void RemoveEntry(FTeamRosterEntry& Entry) const;
+
+public:
+	/**
+	 * Set the team of the player, NoTeam removes the player from the roster
+	 */
+	void SetPlayerTeam(APlayerState* PlayerState, FGenericTeamId TeamId);
+
+	/**
+	 * Remove all players from the roster
+	 */
+	void Reset();
+
+	const TArray<FTeamRosterEntry>& GetEntries() const { return Entries; }
+
+public:
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FTeamRosterEntry, FTeamRosterList>(Entries, DeltaParms, *this);
+	}
+
+};
+
+template<>
+struct TStructOpsTypeTraits<FTeamRosterList> : public TStructOpsTypeTraitsBase2<FTeamRosterList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,54 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameplayTagContainer.h"
+
+#include "TeamTagReplicationPolicy.generated.h"
+
+
+/**
+ * How changes to the stack count of a team tag are replicated
+ * 
+ * Tips:
+ *	Changes made within MinInterval of the last replicated change are coalesced into a single delta
+ */
+USTRUCT(BlueprintType)
+struct GTEXT_API FTeamTagReplicationPolicy
+{
+	GENERATED_BODY()
+public:
+	FTeamTagReplicationPolicy() {}
+
+public:
+	//
+	// Tag that this policy applies to (child tags are included)
+	//
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	FGameplayTag Tag;
+
+	//
+	// Minimum seconds between two replicated changes of the tag
+	//
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (ClampMin = 0.0, Units = "s"))
+	float MinInterval{ 0.25f };
+
+	//
+	// Stack count is replicated rounded down to a multiple of this step (1 replicates the exact value)
+	// 
+	// Tips:
+	//	For large counters (e.g., score, experience) the exact value is replicated on ATeamInfoBase::FlushTeamTagStacks()
+	//
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (ClampMin = 1))
+	int32 QuantizationStep{ 1 };
+
+public:
+	/**
+	 * Returns the stack count that is replicated for the value
+	 */
+	FORCEINLINE int32 Quantize(int32 StackCount) const
+	{
+		return (QuantizationStep > 1) ? ((StackCount / QuantizationStep) * QuantizationStep) : StackCount;
+	}
+
+};
@@ -0,0 +1,48 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamAttitudeMatrix.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamAttitudeMatrix)
+
+
+void FTeamAttitudeMatrix::Reset(ETeamAttitude::Type DefaultAttitude)
+{
+	// Fill every pair with the default attitude
+
+	auto FilledWord{ 0ull };
+	for (auto Pair{ 0 }; Pair < 32; ++Pair)
+	{
+		FilledWord |= static_cast<uint64>(DefaultAttitude & 3) << (Pair << 1);
+	}
+
+	for (auto& Row : Rows)
+	{
+		for (auto& Word : Row)
+		{
+			Word = FilledWord;
+		}
+	}
+
+	// Teams are always friendly to themselves and no team is neutral to everyone
+
+	const auto NoTeam{ FGenericTeamId::NoTeam.GetId() };
+
+	for (auto Index{ 0 }; Index < MaxTeams; ++Index)
+	{
+		const auto Team{ static_cast<uint8>(Index) };
+
+		SetUnchecked(Team, Team, ETeamAttitude::Friendly);
+		SetUnchecked(Team, NoTeam, ETeamAttitude::Neutral);
+		SetUnchecked(NoTeam, Team, ETeamAttitude::Neutral);
+	}
+}
+
+void FTeamAttitudeMatrix::Set(FGenericTeamId TeamA, FGenericTeamId TeamB, ETeamAttitude::Type Attitude)
+{
+	if ((TeamA == TeamB) || (TeamA == FGenericTeamId::NoTeam) || (TeamB == FGenericTeamId::NoTeam))
+	{
+		return;
+	}
+
+	SetUnchecked(TeamA.GetId(), TeamB.GetId(), Attitude);
+}
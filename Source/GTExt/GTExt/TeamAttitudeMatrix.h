@@ -0,0 +1,106 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GenericTeamAgentInterface.h"
+
+#include "TeamAttitudeMatrix.generated.h"
+
+
+/**
+ * Attitude setting between two teams
+ */
+USTRUCT(BlueprintType)
+struct FTeamAttitudeSetting
+{
+	GENERATED_BODY()
+public:
+	FTeamAttitudeSetting() {}
+
+public:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	uint8 TeamA{ 0 };
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	uint8 TeamB{ 0 };
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	TEnumAsByte<ETeamAttitude::Type> Attitude{ ETeamAttitude::Friendly };
+
+	//
+	// Whether TeamB has the same attitude towards TeamA
+	//
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	bool bMutual{ true };
+
+};
+
+
+/**
+ * Precomputed attitude of every team towards every other team
+ *
+ * Tips:
+ *	Attitudes are packed as 2 bits per pair, so a row of 256 teams is 8 words and any pair is a single load.
+ *	A team is always friendly to itself, and FGenericTeamId::NoTeam is neutral to every team
+ */
+class GTEXT_API FTeamAttitudeMatrix
+{
+public:
+	FTeamAttitudeMatrix() { Reset(ETeamAttitude::Hostile); }
+
+	//
+	// Number of team IDs that can be represented by FGenericTeamId
+	//
+	static constexpr int32 MaxTeams{ 256 };
+
+	//
+	// Number of words in a row of the matrix
+	//
+	static constexpr int32 NumRowWords{ MaxTeams / 32 };
+
+protected:
+	uint64 Rows[MaxTeams][NumRowWords];
+
+public:
+	/**
+	 * Reset the attitude between all different teams to the specified attitude
+	 */
+	void Reset(ETeamAttitude::Type DefaultAttitude);
+
+	/**
+	 * Set the attitude of team A towards team B
+	 *
+	 * Note:
+	 *	Attitude of a team towards itself or towards FGenericTeamId::NoTeam cannot be changed
+	 */
+	void Set(FGenericTeamId TeamA, FGenericTeamId TeamB, ETeamAttitude::Type Attitude);
+
+	FORCEINLINE ETeamAttitude::Type Get(FGenericTeamId TeamA, FGenericTeamId TeamB) const
+	{
+		const auto B{ TeamB.GetId() };
+		return static_cast<ETeamAttitude::Type>((Rows[TeamA.GetId()][B >> 5] >> ((B & 31) << 1)) & 3);
+	}
+
+	/**
+	 * Returns the packed attitudes of team A towards every team
+	 */
+	FORCEINLINE const uint64* GetRow(FGenericTeamId TeamA) const { return Rows[TeamA.GetId()]; }
+
+	/**
+	 * Extracts the attitude towards team B from a row returned by GetRow()
+	 */
+	static FORCEINLINE ETeamAttitude::Type GetFromRow(const uint64* Row, uint8 TeamB)
+	{
+		return static_cast<ETeamAttitude::Type>((Row[TeamB >> 5] >> ((TeamB & 31) << 1)) & 3);
+	}
+
+protected:
+	FORCEINLINE void SetUnchecked(uint8 TeamA, uint8 TeamB, ETeamAttitude::Type Attitude)
+	{
+		auto& Word{ Rows[TeamA][TeamB >> 5] };
+		const auto Shift{ (TeamB & 31) << 1 };
+
+		Word = (Word & ~(3ull << Shift)) | (static_cast<uint64>(Attitude & 3) << Shift);
+	}
+
+};
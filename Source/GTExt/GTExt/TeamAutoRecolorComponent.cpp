@@ -0,0 +1,141 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamAutoRecolorComponent.h"
+
+#include "TeamManagerSubsystem.h"
+#include "TeamDisplayData.h"
+
+#include "Components/MeshComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamAutoRecolorComponent)
+
+
+const FName UTeamAutoRecolorComponent::NAME_ActorFeatureName("TeamAutoRecolor");
+
+UTeamAutoRecolorComponent::UTeamAutoRecolorComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+
+void UTeamAutoRecolorComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TeamMembersChangedHandle = TMS->OnTeamMembersChangedNative.AddUObject(this, &ThisClass::HandleTeamMembersChanged);
+	}
+
+	RefreshTeam();
+}
+
+void UTeamAutoRecolorComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TMS->OnTeamMembersChangedNative.Remove(TeamMembersChangedHandle);
+
+		if (BoundTeamId != INDEX_NONE)
+		{
+			TMS->GetTeamDisplayDataChangedDelegate(BoundTeamId).RemoveDynamic(this, &ThisClass::HandleTeamDisplayDataChanged);
+		}
+
+		// Return the shared materials right away instead of waiting for the sweep
+
+		if (auto* Owner{ GetOwner() })
+		{
+			Owner->ForEachComponent<UMeshComponent>(bIncludeChildActors, [TMS](UMeshComponent* MeshComponent)
+			{
+				TMS->ReleaseTeamMaterials(MeshComponent);
+			});
+		}
+	}
+
+	TeamMembersChangedHandle.Reset();
+	BoundTeamId = INDEX_NONE;
+	AppliedDisplayData = nullptr;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void UTeamAutoRecolorComponent::RefreshTeam()
+{
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) };
+	if (!TMS)
+	{
+		return;
+	}
+
+	const auto NewTeamId{ TMS->FindTeamFromActor(GetOwner()) };
+
+	if (NewTeamId != BoundTeamId)
+	{
+		if (BoundTeamId != INDEX_NONE)
+		{
+			TMS->GetTeamDisplayDataChangedDelegate(BoundTeamId).RemoveDynamic(this, &ThisClass::HandleTeamDisplayDataChanged);
+		}
+
+		BoundTeamId = NewTeamId;
+
+		if (BoundTeamId != INDEX_NONE)
+		{
+			TMS->GetTeamDisplayDataChangedDelegate(BoundTeamId).AddDynamic(this, &ThisClass::HandleTeamDisplayDataChanged);
+		}
+	}
+
+	RefreshDisplayData();
+}
+
+void UTeamAutoRecolorComponent::RefreshDisplayData()
+{
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) };
+	if (!TMS || (BoundTeamId == INDEX_NONE))
+	{
+		return;
+	}
+
+	const auto* NewDisplayData{ TMS->GetTeamDisplayData(BoundTeamId, BoundTeamId) };
+
+	if (NewDisplayData && (NewDisplayData != AppliedDisplayData))
+	{
+		NewDisplayData->ApplyChangesToActor(GetOwner(), AppliedDisplayData, bIncludeChildActors);
+
+		AppliedDisplayData = NewDisplayData;
+	}
+}
+
+
+void UTeamAutoRecolorComponent::HandleTeamMembersChanged(TConstArrayView<FTeamMemberChangeRecord> Records)
+{
+	const auto* Owner{ GetOwner() };
+	const auto* Pawn{ Cast<APawn>(Owner) };
+	const auto* PlayerState{ Pawn ? Pawn->GetPlayerState() : nullptr };
+
+	for (const auto& Record : Records)
+	{
+		if ((Record.Actor == Owner) || (PlayerState && (Record.Actor == PlayerState)))
+		{
+			RefreshTeam();
+			return;
+		}
+	}
+}
+
+void UTeamAutoRecolorComponent::HandleTeamDisplayDataChanged(const UTeamDisplayData* DisplayData)
+{
+	// The applied asset was edited in place, so there is nothing to compare against
+
+	if (DisplayData && (DisplayData == AppliedDisplayData))
+	{
+		DisplayData->ApplyToActor(GetOwner(), bIncludeChildActors);
+		return;
+	}
+
+	RefreshDisplayData();
+}
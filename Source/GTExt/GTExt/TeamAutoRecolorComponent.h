@@ -0,0 +1,79 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Component/GFCActorComponent.h"
+
+#include "TeamMemberChangeRecord.h"
+
+#include "TeamAutoRecolorComponent.generated.h"
+
+class UTeamDisplayData;
+
+
+/**
+ * Components that keep the owner's meshes and effects colored with the display data of its team
+ * 
+ * Tips:
+ *	Only the parameters that differ from the display data previously applied are rewritten
+ */
+UCLASS(meta = (BlueprintSpawnableComponent))
+class GTEXT_API UTeamAutoRecolorComponent : public UGFCActorComponent
+{
+	GENERATED_BODY()
+public:
+	UTeamAutoRecolorComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	//
+	// Function name used to add this component
+	//
+	static const FName NAME_ActorFeatureName;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual FName GetFeatureName() const override { return NAME_ActorFeatureName; }
+
+
+protected:
+	//
+	// Whether to recolor the components of child actors as well
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Team")
+	bool bIncludeChildActors{ true };
+
+	//
+	// Display data currently applied to the owner
+	//
+	UPROPERTY(Transient)
+	TObjectPtr<const UTeamDisplayData> AppliedDisplayData{ nullptr };
+
+	//
+	// Team whose display data notification is bound
+	//
+	int32 BoundTeamId{ INDEX_NONE };
+
+	FDelegateHandle TeamMembersChangedHandle;
+
+public:
+	/**
+	 * Re-evaluate the team of the owner and apply its display data if it changed
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Team")
+	void RefreshTeam();
+
+	/**
+	 * Apply the display data of the current team if it differs from the one applied
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Team")
+	void RefreshDisplayData();
+
+protected:
+	void HandleTeamMembersChanged(TConstArrayView<FTeamMemberChangeRecord> Records);
+
+	UFUNCTION()
+	void HandleTeamDisplayDataChanged(const UTeamDisplayData* DisplayData);
+
+};
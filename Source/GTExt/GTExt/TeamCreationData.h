@@ -4,6 +4,8 @@
 
 #include "Engine/DataAsset.h"
 
+#include "TeamAttitudeMatrix.h"
+
 #include "TeamCreationData.generated.h"
 
 class UTeamDisplayData;
@@ -35,4 +37,16 @@ public:
 	UPROPERTY(EditDefaultsOnly, Instanced, Category = "Teams")
 	TObjectPtr<UTeamAssignBase> TeamAssignType;
 
+	//
+	// Attitude between teams that are not listed in TeamAttitudes
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Attitude")
+	TEnumAsByte<ETeamAttitude::Type> DefaultTeamAttitude{ ETeamAttitude::Hostile };
+
+	//
+	// Attitude between specific teams, such as alliances or neutral factions
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Attitude")
+	TArray<FTeamAttitudeSetting> TeamAttitudes;
+
 };
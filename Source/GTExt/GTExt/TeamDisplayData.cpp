@@ -2,110 +2,557 @@
 
 #include "TeamDisplayData.h"
 
+#include "TeamManagerSubsystem.h"
+#include "GTExtLogs.h"
+
 #include "Components/MeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "NiagaraComponent.h"
+#include "NiagaraSystem.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "Engine/Texture.h"
+#include "Engine/Engine.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(TeamDisplayData)
 
 
+// FTeamMaterialParameterBlock
+
+namespace TeamDisplayDataLocals
+{
+	static void SetScalarParameter(UMaterialInstanceDynamic* Material, const FMaterialParameterInfo& Info, float Value, int32& InOutIndex)
+	{
+		const auto& Values{ Material->ScalarParameterValues };
+
+		if (Values.IsValidIndex(InOutIndex) && (Values[InOutIndex].ParameterInfo == Info))
+		{
+			Material->SetScalarParameterByIndex(InOutIndex, Value);
+		}
+		else if (Info.Association == EMaterialParameterAssociation::GlobalParameter)
+		{
+			Material->InitializeScalarParameterAndGetIndex(Info.Name, Value, InOutIndex);
+		}
+		else
+		{
+			// Layer parameters cannot be written by index
+
+			Material->SetScalarParameterValueByInfo(Info, Value);
+		}
+	}
+
+	static void SetVectorParameter(UMaterialInstanceDynamic* Material, const FMaterialParameterInfo& Info, const FLinearColor& Value, int32& InOutIndex)
+	{
+		const auto& Values{ Material->VectorParameterValues };
+
+		if (Values.IsValidIndex(InOutIndex) && (Values[InOutIndex].ParameterInfo == Info))
+		{
+			Material->SetVectorParameterByIndex(InOutIndex, Value);
+		}
+		else if (Info.Association == EMaterialParameterAssociation::GlobalParameter)
+		{
+			Material->InitializeVectorParameterAndGetIndex(Info.Name, Value, InOutIndex);
+		}
+		else
+		{
+			Material->SetVectorParameterValueByInfo(Info, Value);
+		}
+	}
+}
+
+void FTeamMaterialParameterBlock::InitializeIndices() const
+{
+	if (ScalarIndices.Num() != Scalars.Num())
+	{
+		ScalarIndices.Init(INDEX_NONE, Scalars.Num());
+	}
+
+	if (VectorIndices.Num() != Vectors.Num())
+	{
+		VectorIndices.Init(INDEX_NONE, Vectors.Num());
+	}
+}
+
+void FTeamMaterialParameterBlock::ApplyTo(UMaterialInstanceDynamic* Material, const UTeamDisplayData* PreviousData) const
+{
+	InitializeIndices();
+
+	for (auto Index{ 0 }; Index < Scalars.Num(); ++Index)
+	{
+		const auto& KVP{ Scalars[Index] };
+		const auto* PreviousValue{ PreviousData ? PreviousData->GetScalarParameters().Find(KVP.Key.Name) : nullptr };
+
+		if (!PreviousValue || (*PreviousValue != KVP.Value))
+		{
+			TeamDisplayDataLocals::SetScalarParameter(Material, KVP.Key, KVP.Value, ScalarIndices[Index]);
+		}
+	}
+
+	for (auto Index{ 0 }; Index < Vectors.Num(); ++Index)
+	{
+		const auto& KVP{ Vectors[Index] };
+		const auto* PreviousValue{ PreviousData ? PreviousData->GetColorParameters().Find(KVP.Key.Name) : nullptr };
+
+		if (!PreviousValue || (FLinearColor(PreviousValue->R, PreviousValue->G, PreviousValue->B, 1.0f) != KVP.Value))
+		{
+			TeamDisplayDataLocals::SetVectorParameter(Material, KVP.Key, KVP.Value, VectorIndices[Index]);
+		}
+	}
+
+	for (const auto& KVP : Textures)
+	{
+		const auto* PreviousValue{ PreviousData ? PreviousData->GetTextureParameters().Find(KVP.Key.Name) : nullptr };
+
+		if (!PreviousValue || (*PreviousValue != KVP.Value))
+		{
+			Material->SetTextureParameterValueByInfo(KVP.Key, KVP.Value);
+		}
+	}
+}
+
+void FTeamMaterialParameterBlock::ResetMissingFrom(UMaterialInstanceDynamic* Material, const UTeamDisplayData* NewData) const
+{
+	const auto* ParentMaterial{ Material->Parent.Get() };
+	if (!ParentMaterial)
+	{
+		return;
+	}
+
+	InitializeIndices();
+
+	for (auto Index{ 0 }; Index < Scalars.Num(); ++Index)
+	{
+		const auto& Info{ Scalars[Index].Key };
+		auto Value{ 0.0f };
+
+		if (!NewData->GetScalarParameters().Contains(Info.Name) && ParentMaterial->GetScalarParameterValue(FHashedMaterialParameterInfo(Info), Value))
+		{
+			TeamDisplayDataLocals::SetScalarParameter(Material, Info, Value, ScalarIndices[Index]);
+		}
+	}
+
+	for (auto Index{ 0 }; Index < Vectors.Num(); ++Index)
+	{
+		const auto& Info{ Vectors[Index].Key };
+		auto Value{ FLinearColor::Black };
+
+		if (!NewData->GetColorParameters().Contains(Info.Name) && ParentMaterial->GetVectorParameterValue(FHashedMaterialParameterInfo(Info), Value))
+		{
+			TeamDisplayDataLocals::SetVectorParameter(Material, Info, Value, VectorIndices[Index]);
+		}
+	}
+
+	for (const auto& KVP : Textures)
+	{
+		UTexture* Value{ nullptr };
+
+		if (!NewData->GetTextureParameters().Contains(KVP.Key.Name) && ParentMaterial->GetTextureParameterValue(FHashedMaterialParameterInfo(KVP.Key), Value))
+		{
+			Material->SetTextureParameterValueByInfo(KVP.Key, Value);
+		}
+	}
+}
+
+
+// UTeamDisplayData
+
 UTeamDisplayData::UTeamDisplayData(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 }
 
+#if WITH_EDITOR
+void UTeamDisplayData::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	ClearParameterBlockCache();
+
+	// Update teams using this data in all worlds
+
+	for (const auto& WorldContext : GEngine->GetWorldContexts())
+	{
+		if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(WorldContext.World()) })
+		{
+			TMS->NotifyTeamDisplayDataModified(this);
+		}
+	}
+}
+#endif
+
+void UTeamDisplayData::ClearParameterBlockCache() const
+{
+	ParameterBlockCache.Reset();
+	PrimitiveDataValues.Reset();
+	bPrimitiveDataResolved = false;
+}
+
 
-void UTeamDisplayData::ApplyToMaterial(UMaterialInstanceDynamic* Material) const
+const FTeamMaterialParameterBlock& UTeamDisplayData::GetParameterBlock(const UMaterialInterface* ParentMaterial) const
 {
-	if (Material)
+	if (const auto* CachedBlock{ ParameterBlockCache.Find(ParentMaterial) })
 	{
-		for (const auto& KVP : ScalarParameters)
+		return *CachedBlock;
+	}
+
+	auto& Block{ ParameterBlockCache.Add(ParentMaterial) };
+
+	if (!ParentMaterial)
+	{
+		return Block;
+	}
+
+	// Resolve the parameters against the ones the material exposes so that missing parameters are never written
+
+	TArray<FMaterialParameterInfo> ParameterInfos;
+	TArray<FGuid> ParameterIds;
+
+	const auto bUsePrimitiveData{ ApplyMode == ETeamDisplayApplyMode::CustomPrimitiveData };
+
+	if (!ScalarParameters.IsEmpty())
+	{
+		ParentMaterial->GetAllScalarParameterInfo(ParameterInfos, ParameterIds);
+
+		for (const auto& Info : ParameterInfos)
 		{
-			Material->SetScalarParameterValue(KVP.Key, KVP.Value);
+			const auto* Value{ ScalarParameters.Find(Info.Name) };
+
+			if (Value && !(bUsePrimitiveData && ScalarPrimitiveDataIndices.Contains(Info.Name)))
+			{
+				Block.Scalars.Emplace(Info, *Value);
+			}
 		}
+	}
 
-		for (const auto& KVP : ColorParameters)
+	if (!ColorParameters.IsEmpty())
+	{
+		ParentMaterial->GetAllVectorParameterInfo(ParameterInfos, ParameterIds);
+
+		for (const auto& Info : ParameterInfos)
 		{
-			Material->SetVectorParameterValue(KVP.Key, FVector(KVP.Value));
+			const auto* Value{ ColorParameters.Find(Info.Name) };
+
+			// Materials have always been given opaque colors, so the alpha of the data is not used
+
+			if (Value && !(bUsePrimitiveData && ColorPrimitiveDataIndices.Contains(Info.Name)))
+			{
+				Block.Vectors.Emplace(Info, FLinearColor(Value->R, Value->G, Value->B, 1.0f));
+			}
 		}
+	}
 
-		for (const auto& KVP : TextureParameters)
+	if (!TextureParameters.IsEmpty())
+	{
+		ParentMaterial->GetAllTextureParameterInfo(ParameterInfos, ParameterIds);
+
+		for (const auto& Info : ParameterInfos)
 		{
-			Material->SetTextureParameterValue(KVP.Key, KVP.Value);
+			if (const auto* Value{ TextureParameters.Find(Info.Name) })
+			{
+				Block.Textures.Emplace(Info, *Value);
+			}
 		}
 	}
+
+	return Block;
 }
 
-void UTeamDisplayData::ApplyToMeshComponent(UMeshComponent* MeshComponent) const
+
+const TArray<TPair<int32, float>>& UTeamDisplayData::GetPrimitiveDataValues() const
 {
-	if (MeshComponent)
+	if (!bPrimitiveDataResolved)
 	{
-		for (const auto& KVP : ScalarParameters)
+		bPrimitiveDataResolved = true;
+		PrimitiveDataValues.Reset();
+
+		for (const auto& KVP : ScalarPrimitiveDataIndices)
 		{
-			MeshComponent->SetScalarParameterValueOnMaterials(KVP.Key, KVP.Value);
+			if (const auto* Value{ ScalarParameters.Find(KVP.Key) }; Value && (KVP.Value >= 0))
+			{
+				PrimitiveDataValues.Emplace(KVP.Value, *Value);
+			}
 		}
 
-		for (const auto& KVP : ColorParameters)
+		for (const auto& KVP : ColorPrimitiveDataIndices)
+		{
+			if (const auto* Value{ ColorParameters.Find(KVP.Key) }; Value && (KVP.Value >= 0))
+			{
+				PrimitiveDataValues.Emplace(KVP.Value + 0, Value->R);
+				PrimitiveDataValues.Emplace(KVP.Value + 1, Value->G);
+				PrimitiveDataValues.Emplace(KVP.Value + 2, Value->B);
+				PrimitiveDataValues.Emplace(KVP.Value + 3, Value->A);
+			}
+		}
+	}
+
+	return PrimitiveDataValues;
+}
+
+void UTeamDisplayData::ApplyToMaterial(UMaterialInstanceDynamic* Material) const
+{
+	if (Material)
+	{
+		GetParameterBlock(Material->Parent).ApplyTo(Material);
+	}
+}
+
+void UTeamDisplayData::ApplyToMeshComponent(UMeshComponent* MeshComponent) const
+{
+	ApplyChangesToMeshComponent(MeshComponent, nullptr);
+}
+
+void UTeamDisplayData::ApplyChangesToMeshComponent(UMeshComponent* MeshComponent, const UTeamDisplayData* PreviousData) const
+{
+	// Data applied in another way cannot be compared
+
+	if (PreviousData && (PreviousData->ApplyMode != ApplyMode))
+	{
+		PreviousData = nullptr;
+	}
+
+	if (MeshComponent)
+	{
+		const auto bUsePrimitiveData{ ApplyMode == ETeamDisplayApplyMode::CustomPrimitiveData };
+
+		if (bUsePrimitiveData)
 		{
-			MeshComponent->SetVectorParameterValueOnMaterials(KVP.Key, FVector(KVP.Value));
+			const auto* PreviousValues{ PreviousData ? &PreviousData->GetPrimitiveDataValues() : nullptr };
+			const auto& Values{ GetPrimitiveDataValues() };
+
+			for (const auto& KVP : Values)
+			{
+				if (!PreviousValues || !PreviousValues->Contains(KVP))
+				{
+					MeshComponent->SetCustomPrimitiveDataFloat(KVP.Key, KVP.Value);
+				}
+			}
+
+			// Clear the indices that only the previous data wrote
+
+			if (PreviousValues)
+			{
+				for (const auto& KVP : *PreviousValues)
+				{
+					const auto bWritten
+					{
+						Values.ContainsByPredicate([&KVP](const TPair<int32, float>& Value)
+						{
+							return Value.Key == KVP.Key;
+						})
+					};
+
+					if (!bWritten)
+					{
+						MeshComponent->SetCustomPrimitiveDataFloat(KVP.Key, 0.0f);
+					}
+				}
+			}
 		}
 
-		const auto MaterialInterfaces{ MeshComponent->GetMaterials() };
-		for (auto MaterialIndex{ 0 }; MaterialIndex < MaterialInterfaces.Num(); ++MaterialIndex)
+		auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(MeshComponent->GetWorld()) };
+
+		const auto NumMaterials{ MeshComponent->GetNumMaterials() };
+
+		for (auto MaterialIndex{ 0 }; MaterialIndex < NumMaterials; ++MaterialIndex)
 		{
-			if (const auto& MaterialInterface{ MaterialInterfaces[MaterialIndex] })
+			auto* MaterialInterface{ MeshComponent->GetMaterial(MaterialIndex) };
+			if (!MaterialInterface)
+			{
+				continue;
+			}
+
+			auto* DynamicMaterial{ Cast<UMaterialInstanceDynamic>(MaterialInterface) };
+			auto* ParentMaterial{ DynamicMaterial ? DynamicMaterial->Parent.Get() : MaterialInterface };
+
+			const auto& Block{ GetParameterBlock(ParentMaterial) };
+			const auto* PreviousBlock{ PreviousData ? &PreviousData->GetParameterBlock(ParentMaterial) : nullptr };
+
+			if (Block.IsEmpty() && (!PreviousBlock || PreviousBlock->IsEmpty()))
+			{
+				continue;
+			}
+
+			// Parameters are the same for the whole team, so one material per parent is enough
+
+			if (TMS && (ApplyMode != ETeamDisplayApplyMode::DynamicMaterials))
 			{
-				auto* DynamicMaterial{ Cast<UMaterialInstanceDynamic>(MaterialInterface) };
+				if (!Block.IsEmpty())
+				{
+					TMS->ApplyTeamMaterial(MeshComponent, MaterialIndex, ParentMaterial, this);
+				}
+				else if (DynamicMaterial && TMS->IsPooledTeamMaterial(DynamicMaterial))
+				{
+					// Nothing to write for this parent, so the slot goes back to it instead of keeping the previous team's material
+
+					TMS->ReleaseTeamMaterial(DynamicMaterial, MeshComponent, MaterialIndex);
+					MeshComponent->SetMaterial(MaterialIndex, ParentMaterial);
+				}
+
+				continue;
+			}
+
+			// Never write to a material shared by a team, the component gets its own from the parent instead
 
-				if (!DynamicMaterial)
+			if (!DynamicMaterial || (TMS && TMS->IsPooledTeamMaterial(DynamicMaterial)))
+			{
+				if (Block.IsEmpty())
 				{
-					DynamicMaterial = MeshComponent->CreateAndSetMaterialInstanceDynamic(MaterialIndex);
+					continue;
 				}
 
-				for (const auto& KVP : TextureParameters)
+				DynamicMaterial = MeshComponent->CreateAndSetMaterialInstanceDynamicFromMaterial(MaterialIndex, ParentMaterial);
+
+				Block.ApplyTo(DynamicMaterial);
+			}
+			else
+			{
+				// Parameters only the previous data had would otherwise keep its values
+
+				if (PreviousBlock)
 				{
-					DynamicMaterial->SetTextureParameterValue(KVP.Key, KVP.Value);
+					PreviousBlock->ResetMissingFrom(DynamicMaterial, this);
 				}
+
+				Block.ApplyTo(DynamicMaterial, PreviousData);
 			}
 		}
 	}
 }
 
+void UTeamDisplayData::ApplyToInstance(UInstancedStaticMeshComponent* InstancedMeshComponent, int32 InstanceIndex, bool bMarkRenderStateDirty) const
+{
+	if (InstancedMeshComponent && InstancedMeshComponent->IsValidInstance(InstanceIndex))
+	{
+		for (const auto& KVP : GetPrimitiveDataValues())
+		{
+			UE_CLOG(KVP.Key >= InstancedMeshComponent->NumCustomDataFloats, LogGameExt_Team, Warning,
+				TEXT("ApplyToInstance: %s needs at least %d custom data floats on %s"), *GetNameSafe(this), KVP.Key + 1, *GetNameSafe(InstancedMeshComponent));
+
+			InstancedMeshComponent->SetCustomDataValue(InstanceIndex, KVP.Key, KVP.Value, false);
+		}
+
+		if (bMarkRenderStateDirty)
+		{
+			InstancedMeshComponent->MarkRenderStateDirty();
+		}
+	}
+}
+
 void UTeamDisplayData::ApplyToNiagaraComponent(UNiagaraComponent* NiagaraComponent) const
+{
+	ApplyChangesToNiagaraComponent(NiagaraComponent, nullptr);
+}
+
+void UTeamDisplayData::ApplyChangesToNiagaraComponent(UNiagaraComponent* NiagaraComponent, const UTeamDisplayData* PreviousData) const
 {
 	if (NiagaraComponent)
 	{
 		for (const auto& KVP : ScalarParameters)
 		{
-			NiagaraComponent->SetVariableFloat(KVP.Key, KVP.Value);
+			const auto* PreviousValue{ PreviousData ? PreviousData->ScalarParameters.Find(KVP.Key) : nullptr };
+
+			if (!PreviousValue || (*PreviousValue != KVP.Value))
+			{
+				NiagaraComponent->SetVariableFloat(KVP.Key, KVP.Value);
+			}
 		}
 
 		for (const auto& KVP : ColorParameters)
 		{
-			NiagaraComponent->SetVariableLinearColor(KVP.Key, KVP.Value);
+			const auto* PreviousValue{ PreviousData ? PreviousData->ColorParameters.Find(KVP.Key) : nullptr };
+
+			if (!PreviousValue || (*PreviousValue != KVP.Value))
+			{
+				NiagaraComponent->SetVariableLinearColor(KVP.Key, KVP.Value);
+			}
 		}
 
 		for (const auto& KVP : TextureParameters)
 		{
-			NiagaraComponent->SetVariableTexture(KVP.Key, KVP.Value);
+			const auto* PreviousValue{ PreviousData ? PreviousData->TextureParameters.Find(KVP.Key) : nullptr };
+
+			if (!PreviousValue || (*PreviousValue != KVP.Value))
+			{
+				NiagaraComponent->SetVariableTexture(KVP.Key, KVP.Value);
+			}
+		}
+
+		// Parameters only the previous data had go back to the values of the system
+
+		if (PreviousData)
+		{
+			ResetNiagaraParametersOf(NiagaraComponent, PreviousData);
+		}
+	}
+}
+
+void UTeamDisplayData::ResetNiagaraParametersOf(UNiagaraComponent* NiagaraComponent, const UTeamDisplayData* PreviousData) const
+{
+	auto* System{ NiagaraComponent->GetAsset() };
+	if (!System)
+	{
+		return;
+	}
+
+	const auto& Defaults{ System->GetExposedParameters() };
+
+	for (const auto& KVP : PreviousData->ScalarParameters)
+	{
+		if (!ScalarParameters.Contains(KVP.Key))
+		{
+			const FNiagaraVariable Variable{ FNiagaraTypeDefinition::GetFloatDef(), KVP.Key };
+
+			if (Defaults.IndexOf(Variable) != INDEX_NONE)
+			{
+				NiagaraComponent->SetVariableFloat(KVP.Key, Defaults.GetParameterValue<float>(Variable));
+			}
+		}
+	}
+
+	for (const auto& KVP : PreviousData->ColorParameters)
+	{
+		if (!ColorParameters.Contains(KVP.Key))
+		{
+			const FNiagaraVariable Variable{ FNiagaraTypeDefinition::GetColorDef(), KVP.Key };
+
+			if (Defaults.IndexOf(Variable) != INDEX_NONE)
+			{
+				NiagaraComponent->SetVariableLinearColor(KVP.Key, Defaults.GetParameterValue<FLinearColor>(Variable));
+			}
+		}
+	}
+
+	for (const auto& KVP : PreviousData->TextureParameters)
+	{
+		if (!TextureParameters.Contains(KVP.Key))
+		{
+			const FNiagaraVariable Variable{ FNiagaraTypeDefinition::GetUTextureDef(), KVP.Key };
+
+			if (Defaults.IndexOf(Variable) != INDEX_NONE)
+			{
+				NiagaraComponent->SetVariableTexture(KVP.Key, Cast<UTexture>(Defaults.GetUObject(Variable)));
+			}
 		}
 	}
 }
 
 void UTeamDisplayData::ApplyToActor(AActor* TargetActor, bool bIncludeChildActors) const
+{
+	ApplyChangesToActor(TargetActor, nullptr, bIncludeChildActors);
+}
+
+void UTeamDisplayData::ApplyChangesToActor(AActor* TargetActor, const UTeamDisplayData* PreviousData, bool bIncludeChildActors) const
 {
 	if (TargetActor != nullptr)
 	{
-		TargetActor->ForEachComponent(bIncludeChildActors, [this](UActorComponent* InComponent)
+		TargetActor->ForEachComponent(bIncludeChildActors, [this, PreviousData](UActorComponent* InComponent)
 		{
 			if (auto* MeshComponent{ Cast<UMeshComponent>(InComponent) })
 			{
-				ApplyToMeshComponent(MeshComponent);
+				ApplyChangesToMeshComponent(MeshComponent, PreviousData);
 			}
 			else if (auto* NiagaraComponent{ Cast<UNiagaraComponent>(InComponent) })
 			{
-				ApplyToNiagaraComponent(NiagaraComponent);
+				ApplyChangesToNiagaraComponent(NiagaraComponent, PreviousData);
 			}
 		});
 	}
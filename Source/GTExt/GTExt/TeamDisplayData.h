@@ -3,14 +3,77 @@
 #pragma once
 
 #include "Engine/DataAsset.h"
+#include "Materials/MaterialParameters.h"
 
 #include "TeamDisplayData.generated.h"
 
 class UMaterialInstanceDynamic;
+class UMaterialInterface;
 class UMeshComponent;
+class UInstancedStaticMeshComponent;
 class UNiagaraComponent;
 class AActor;
 class UTexture;
+class UTeamDisplayData;
+
+
+/**
+ * How team display data is applied to mesh components
+ */
+UENUM(BlueprintType)
+enum class ETeamDisplayApplyMode : uint8
+{
+	DynamicMaterials,		// Parameters are written to dynamic material instances created for each mesh component
+
+	SharedMaterials,		// Parameters are written to dynamic material instances shared by the team from the pool of UTeamManagerSubsystem
+
+	CustomPrimitiveData		// Parameters with a primitive data index are written to custom primitive data, others to materials shared by the team
+};
+
+
+/**
+ * Parameters of a team display data that exist on a parent material, with their parameter infos resolved
+ * 
+ * Tips:
+ *	Built once per (display data, parent material) so applying to a material slot only writes parameters the material has
+ */
+struct GTEXT_API FTeamMaterialParameterBlock
+{
+public:
+	TArray<TPair<FMaterialParameterInfo, float>> Scalars;
+	TArray<TPair<FMaterialParameterInfo, FLinearColor>> Vectors;
+	TArray<TPair<FMaterialParameterInfo, TObjectPtr<UTexture>>> Textures;
+
+	//
+	// Index of each scalar and vector parameter in the parameter values of the last material it was written to
+	// 
+	// Tips:
+	//	Materials created from the same parent get their parameters in the same order,
+	//	so the index is usually valid for the next material too and the linear search by name is skipped
+	//
+	mutable TArray<int32> ScalarIndices;
+	mutable TArray<int32> VectorIndices;
+
+public:
+	FORCEINLINE bool IsEmpty() const { return Scalars.IsEmpty() && Vectors.IsEmpty() && Textures.IsEmpty(); }
+
+	/**
+	 * Write the parameters of the block to the material, skipping those with the same value in the previously applied data
+	 */
+	void ApplyTo(UMaterialInstanceDynamic* Material, const UTeamDisplayData* PreviousData = nullptr) const;
+
+	/**
+	 * Write the values of the parent material to the parameters of the block that the new data does not have
+	 * 
+	 * Tips:
+	 *	Called on the block of the previously applied data so that its parameters do not stay on the material
+	 */
+	void ResetMissingFrom(UMaterialInstanceDynamic* Material, const UTeamDisplayData* NewData) const;
+
+private:
+	void InitializeIndices() const;
+
+};
 
 
 /**
@@ -39,20 +102,118 @@ protected:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
 	FText TeamName;
 
+	//
+	// How this data is applied to mesh components
+	// 
+	// Tips:
+	//	SharedMaterials keeps one material per team and parent material instead of one per component and slot.
+	//	CustomPrimitiveData also keeps materials shared so that draw calls can be merged and instances keep batching
+	//
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+	ETeamDisplayApplyMode ApplyMode{ ETeamDisplayApplyMode::DynamicMaterials };
+
+	//
+	// Custom primitive data index of each scalar parameter
+	//
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta = (EditCondition = "ApplyMode == ETeamDisplayApplyMode::CustomPrimitiveData"))
+	TMap<FName, int32> ScalarPrimitiveDataIndices;
+
+	//
+	// First custom primitive data index of each color parameter, which uses four consecutive indices (RGBA)
+	//
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta = (EditCondition = "ApplyMode == ETeamDisplayApplyMode::CustomPrimitiveData"))
+	TMap<FName, int32> ColorPrimitiveDataIndices;
+
+protected:
+	//
+	// Parameter blocks resolved for each parent material this data has been applied to
+	//
+	mutable TMap<TObjectKey<UMaterialInterface>, FTeamMaterialParameterBlock> ParameterBlockCache;
+
+	//
+	// Custom primitive data values as (index, value), resolved on first use
+	//
+	mutable TArray<TPair<int32, float>> PrimitiveDataValues;
+	mutable bool bPrimitiveDataResolved{ false };
+
+protected:
+	/**
+	 * Returns the custom primitive data values of this data
+	 */
+	const TArray<TPair<int32, float>>& GetPrimitiveDataValues() const;
+
+	/**
+	 * Write the values exposed by the Niagara system to the user parameters that only the previous data has
+	 */
+	void ResetNiagaraParametersOf(UNiagaraComponent* NiagaraComponent, const UTeamDisplayData* PreviousData) const;
+
+public:
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/**
+	 * Returns the parameters of this data that exist on the parent material and are written to materials
+	 */
+	const FTeamMaterialParameterBlock& GetParameterBlock(const UMaterialInterface* ParentMaterial) const;
+
+	/**
+	 * Discard all resolved parameter blocks
+	 */
+	void ClearParameterBlockCache() const;
+
+	const TMap<FName, float>& GetScalarParameters() const { return ScalarParameters; }
+	const TMap<FName, FLinearColor>& GetColorParameters() const { return ColorParameters; }
+	const TMap<FName, TObjectPtr<UTexture>>& GetTextureParameters() const { return TextureParameters; }
+
 public:
 	UFUNCTION(BlueprintCallable, Category= "Team")
 	void ApplyToMaterial(UMaterialInstanceDynamic* Material) const;
 
+	/**
+	 * Apply to every material slot of the mesh in a single pass
+	 * 
+	 * Tips:
+	 *	Dynamic material instances are only created for slots whose material has any of the parameters.
+	 *	With SharedMaterials or CustomPrimitiveData, those slots use materials shared by every component of this data instead
+	 */
 	UFUNCTION(BlueprintCallable, Category= "Team")
 	void ApplyToMeshComponent(UMeshComponent* MeshComponent) const;
 
+	/**
+	 * Write the custom primitive data values of this data to the per instance custom data of the instance
+	 * 
+	 * Tips:
+	 *	Lets instances of different teams share one instanced mesh component.
+	 *	Texture parameters and parameters without a primitive data index cannot vary per instance and are not applied
+	 */
+	UFUNCTION(BlueprintCallable, Category= "Team")
+	void ApplyToInstance(UInstancedStaticMeshComponent* InstancedMeshComponent, int32 InstanceIndex, bool bMarkRenderStateDirty = true) const;
+
 	UFUNCTION(BlueprintCallable, Category= "Team")
 	void ApplyToNiagaraComponent(UNiagaraComponent* NiagaraComponent) const;
 
 	UFUNCTION(BlueprintCallable, Category= "Team", meta = (DefaultToSelf = "TargetActor"))
 	void ApplyToActor(AActor* TargetActor, bool bIncludeChildActors = true) const;
 
+	/**
+	 * Apply only the parameters whose values differ from the display data previously applied
+	 * 
+	 * Tips:
+	 *	Parameters set only by the previous data are reset to the values of the parent material or Niagara system,
+	 *	and their custom primitive data is cleared to zero.
+	 *	Falls back to applying everything when PreviousData is nullptr or uses another apply mode
+	 */
+	void ApplyChangesToMeshComponent(UMeshComponent* MeshComponent, const UTeamDisplayData* PreviousData) const;
+	void ApplyChangesToNiagaraComponent(UNiagaraComponent* NiagaraComponent, const UTeamDisplayData* PreviousData) const;
+
+	UFUNCTION(BlueprintCallable, Category= "Team", meta = (DefaultToSelf = "TargetActor"))
+	void ApplyChangesToActor(AActor* TargetActor, const UTeamDisplayData* PreviousData, bool bIncludeChildActors = true) const;
+
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Team")
 	const FText& GetTeamName() const { return TeamName; }
 
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Team")
+	ETeamDisplayApplyMode GetApplyMode() const { return ApplyMode; }
+
 };
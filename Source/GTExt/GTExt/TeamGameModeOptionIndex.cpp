@@ -0,0 +1,154 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamGameModeOptionIndex.h"
+
+#include "TeamManagerSubsystem.h"
+#include "TeamStateSnapshot.h"
+#include "GTExtLogs.h"
+
+#include "GameFramework/PlayerState.h"
+#include "GameplayTagsManager.h"
+
+
+void FTeamGameModeOptionIndex::Update(const FString& Options, const FTeamStateSnapshot* Snapshot)
+{
+	// A changed options string usually differs in length, which is checked before comparing characters
+
+	if (!bBuilt || (SourceOptions.Len() != Options.Len()) || !SourceOptions.Equals(Options, ESearchCase::CaseSensitive))
+	{
+		Build(Options);
+
+		if (Snapshot)
+		{
+			ApplySnapshot(*Snapshot);
+		}
+	}
+}
+
+void FTeamGameModeOptionIndex::Reset()
+{
+	SourceOptions.Reset();
+	bBuilt = false;
+
+	MemberTeamIds.Reset();
+	TeamStats.Reset();
+	SnapshotMemberTeamIds.Reset();
+}
+
+const int32* FTeamGameModeOptionIndex::FindMemberTeamId(const APlayerState* PlayerState) const
+{
+	check(PlayerState);
+
+	if (!SnapshotMemberTeamIds.IsEmpty())
+	{
+		if (const auto* TeamId{ SnapshotMemberTeamIds.Find(FTeamStateSnapshot::MakeMemberKey(PlayerState)) })
+		{
+			return TeamId;
+		}
+	}
+
+	return MemberTeamIds.Find(PlayerState->GetPlayerName());
+}
+
+
+void FTeamGameModeOptionIndex::Build(const FString& Options)
+{
+	Reset();
+
+	SourceOptions = Options;
+	bBuilt = true;
+
+	static const FString MemberKeyPrefix{ TEXT("TM[") };
+	static const FString TeamKeyPrefix{ UTeamManagerSubsystem::NAME_TeamStatOptionKey + TEXT("[") };
+
+	TArray<FString> Pairs;
+	Options.ParseIntoArray(Pairs, TEXT("?"));
+
+	for (const auto& Pair : Pairs)
+	{
+		// Pairs without a value are treated as an empty value like UGameplayStatics::GetKeyValue
+
+		FString Key;
+		FString Value;
+
+		if (!Pair.Split(TEXT("="), &Key, &Value))
+		{
+			Key = Pair;
+		}
+
+		if (!Key.EndsWith(TEXT("]")))
+		{
+			continue;
+		}
+
+		// "TM[<name>]=<id>"
+
+		if (Key.StartsWith(MemberKeyPrefix))
+		{
+			const auto PlayerName{ Key.Mid(MemberKeyPrefix.Len(), Key.Len() - MemberKeyPrefix.Len() - 1) };
+
+			if (!MemberTeamIds.Contains(PlayerName))
+			{
+				MemberTeamIds.Add(PlayerName, FCString::Atoi(*Value));
+			}
+		}
+
+		// "Team[<id>]=<Tag>,<Val>,<Max>:..."
+
+		else if (Key.StartsWith(TeamKeyPrefix))
+		{
+			const auto IdString{ Key.Mid(TeamKeyPrefix.Len(), Key.Len() - TeamKeyPrefix.Len() - 1) };
+			const auto TeamId{ FCString::Atoi(*IdString) };
+
+			// Only accept the key that ATeamInfoBase would look up for the team
+
+			if (IdString.Equals(FString::FromInt(TeamId)) && !TeamStats.Contains(TeamId))
+			{
+				ParseTeamStats(TeamId, Value);
+			}
+		}
+	}
+}
+
+void FTeamGameModeOptionIndex::ParseTeamStats(int32 TeamId, const FString& Value)
+{
+	auto& Stats{ TeamStats.Add(TeamId) };
+
+	TArray<FString> StatStrings;
+	Value.ParseIntoArray(StatStrings, TEXT(":"));
+
+	Stats.Reserve(StatStrings.Num());
+
+	for (const auto& StatString : StatStrings)
+	{
+		TArray<FString> Values;
+		StatString.ParseIntoArray(Values, TEXT(","));
+
+		// Check if the value is correct.
+
+		static constexpr int32 NumValues{ 3 };
+
+		if (ensure(Values.Num() == NumValues))
+		{
+			auto& Stat{ Stats.AddDefaulted_GetRef() };
+			Stat.Tag = UGameplayTagsManager::Get().RequestGameplayTag(FName(Values[0]), true);
+			Stat.StackCount = FCString::Atoi(*Values[1]);
+			Stat.MaxStackCount = FCString::Atoi(*Values[2]);
+		}
+	}
+}
+
+void FTeamGameModeOptionIndex::ApplySnapshot(const FTeamStateSnapshot& Snapshot)
+{
+	for (const auto& Team : Snapshot.Teams)
+	{
+		TeamStats.Add(Team.TeamId, Team.Stats);
+	}
+
+	SnapshotMemberTeamIds.Reserve(Snapshot.Members.Num());
+
+	for (const auto& Member : Snapshot.Members)
+	{
+		SnapshotMemberTeamIds.Add(Member.MemberKey, Member.TeamId);
+	}
+}
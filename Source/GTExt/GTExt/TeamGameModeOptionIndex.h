@@ -0,0 +1,92 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameplayTagContainer.h"
+
+class APlayerState;
+struct FTeamStateSnapshot;
+
+
+/**
+ * Pre-parsed value of a tag stack stored in the game mode option of a team
+ */
+struct FTeamStatOption
+{
+public:
+	FGameplayTag Tag;
+
+	int32 StackCount{ 0 };
+
+	int32 MaxStackCount{ 0 };
+};
+
+
+/**
+ * Index of the team related game mode options, parsed once from the options string
+ *
+ * Tips:
+ *	Keys are compared case-insensitively and the first occurrence of a key wins,
+ *	which is the same rule as UGameplayStatics::HasOption and UGameplayStatics::ParseOption.
+ *	When a team state snapshot is restored after map travel, its values take precedence over the options
+ */
+class GTEXT_API FTeamGameModeOptionIndex
+{
+public:
+	FTeamGameModeOptionIndex() {}
+
+protected:
+	//
+	// Options string this index was built from
+	//
+	FString SourceOptions;
+
+	bool bBuilt{ false };
+
+	//
+	// Team ID of each player name from "?TM[<name>]=<id>"
+	//
+	TMap<FString, int32> MemberTeamIds;
+
+	//
+	// Tag stacks of each team from "?Team[<id>]=<Tag>,<Val>,<Max>:..."
+	//
+	TMap<int32, TArray<FTeamStatOption>> TeamStats;
+
+	//
+	// Team ID of each member key restored from the team state snapshot
+	//
+	TMap<FString, int32> SnapshotMemberTeamIds;
+
+public:
+	/**
+	 * Rebuild the index if it was not built from the options string
+	 */
+	void Update(const FString& Options, const FTeamStateSnapshot* Snapshot = nullptr);
+
+	/**
+	 * Remove all parsed options
+	 */
+	void Reset();
+
+	/**
+	 * Returns the team ID assigned to the player name or nullptr if there is no option for the player
+	 */
+	FORCEINLINE const int32* FindMemberTeamId(const FString& PlayerName) const { return MemberTeamIds.Find(PlayerName); }
+
+	/**
+	 * Returns the team ID assigned to the player from the snapshot first, then from the options
+	 */
+	const int32* FindMemberTeamId(const APlayerState* PlayerState) const;
+
+	/**
+	 * Returns the tag stacks of the team or nullptr if there is no option for the team
+	 */
+	FORCEINLINE const TArray<FTeamStatOption>* FindTeamStats(int32 TeamId) const { return TeamStats.Find(TeamId); }
+
+protected:
+	void Build(const FString& Options);
+	void ApplySnapshot(const FTeamStateSnapshot& Snapshot);
+	void ParseTeamStats(int32 TeamId, const FString& Value);
+
+};
@@ -16,6 +16,8 @@
 
 #include "Net/UnrealNetwork.h"
 #include "GameFramework/PlayerState.h"
+#include "GameFramework/GameModeBase.h"
+#include "TimerManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(TeamManagerComponent)
 
@@ -24,7 +26,12 @@ const FName UTeamManagerComponent::NAME_ActorFeatureName("TeamManager");
 
 UTeamManagerComponent::UTeamManagerComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
+	, Roster(this)
 {
+	// Only ticks while there are players waiting in the assignment queue
+
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
 }
 
 void UTeamManagerComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -32,6 +39,7 @@ void UTeamManagerComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(UTeamManagerComponent, TeamCreationData);
+	DOREPLIFETIME(UTeamManagerComponent, Roster);
 }
 
 
@@ -68,6 +76,13 @@ void UTeamManagerComponent::BeginPlay()
 
 	ensureMsgf(TryToChangeInitState(TAG_InitState_Spawned), TEXT("[%s] on [%s]."), *GetNameSafe(this), *GetNameSafe(GetOwner()));
 
+	// Start replicating the roster of players
+
+	if (bReplicateRoster && GetOwner()->HasAuthority())
+	{
+		StartRosterReplication();
+	}
+
 	// Check if initialization process can continue
 
 	CheckDefaultInitialization();
@@ -75,6 +90,13 @@ void UTeamManagerComponent::BeginPlay()
 
 void UTeamManagerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	FGameModeEvents::GameModeLogoutEvent.RemoveAll(this);
+
+	StopRosterReplication();
+
+	PendingAssignments.Reset();
+	PendingAssignmentHead = 0;
+
 	UnregisterInitStateFeature();
 
 	Super::EndPlay(EndPlayReason);
@@ -173,6 +195,11 @@ void UTeamManagerComponent::ApplyTeamCreationData()
 {
 	check(TeamCreationData);
 
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TMS->ApplyTeamAttitudes(TeamCreationData);
+	}
+
 	if (GetOwner()->HasAuthority())
 	{
 		ServerCreateTeams();
@@ -221,13 +248,18 @@ void UTeamManagerComponent::ServerAssignPlayersToTeams()
 {
 	auto* GameState{ GetGameStateChecked<AGameStateBase>() };
 
-	// Assign players that already exist to teams
+	// Assign players that already exist to teams in one pass
+
+	TArray<APlayerState*> PlayerStates;
+	PlayerStates.Reserve(GameState->PlayerArray.Num());
 
 	for (const auto& PlayerState : GameState->PlayerArray)
 	{
-		ServerChooseTeamForPlayer(PlayerState);
+		PlayerStates.Add(PlayerState);
 	}
 
+	ServerChooseTeamsForPlayers(PlayerStates);
+
 	// Listen for new players logging in
 
 	if (auto* GFCGameMode{ Cast<AGFCGameMode>(GameState->AuthorityGameMode) })
@@ -242,6 +274,10 @@ void UTeamManagerComponent::ServerAssignPlayersToTeams()
 	{
 		UE_LOG(LogGameExt_Team, Warning, TEXT("Can't bind OnPostLogin Event. GameMode must inherit from AGFCGameMode or AGFCGameModeBase to use event binding."));
 	}
+
+	// Listen for players logging out
+
+	FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &ThisClass::OnLogout);
 }
 
 void UTeamManagerComponent::SetTeamCreationData(const UTeamCreationData* NewTeamCreationData)
@@ -265,7 +301,14 @@ void UTeamManagerComponent::OnPostLogin(AGameModeBase* GameMode, AController* Ne
 	auto PlayerState{ NewPlayer->PlayerState };
 	check(PlayerState);
 
-	ServerChooseTeamForPlayer(PlayerState);
+	if (bUseAssignmentQueue)
+	{
+		QueueAssignment(PlayerState);
+	}
+	else
+	{
+		ServerChooseTeamForPlayer(PlayerState);
+	}
 }
 
 void UTeamManagerComponent::ServerChooseTeamForPlayer(APlayerState* PS)
@@ -286,3 +329,167 @@ void UTeamManagerComponent::ServerChooseTeamForPlayer(APlayerState* PS)
 		TeamAssign->AssignTeamForPlayer(TeamCreationData, PS, GS);
 	}
 }
+
+void UTeamManagerComponent::ServerChooseTeamsForPlayers(TArrayView<APlayerState* const> PlayerStates)
+{
+	auto TeamAssign{ TeamCreationData->TeamAssignType };
+	check(TeamAssign);
+
+	auto* GS{ GetGameStateChecked<AGameStateBase>() };
+
+	TeamAssign->AssignTeamsForPlayers(TeamCreationData, PlayerStates, GS);
+}
+
+
+// Rebalance
+
+void UTeamManagerComponent::OnLogout(AGameModeBase* GameMode, AController* Exiting)
+{
+	if (!bAutoRebalanceOnLogout || bAutoRebalanceScheduled || (GameMode != GetGameStateChecked<AGameStateBase>()->AuthorityGameMode))
+	{
+		return;
+	}
+
+	// The leaving player is still counted until its player state is deactivated, so rebalance on the next tick
+
+	bAutoRebalanceScheduled = true;
+
+	GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]()
+	{
+		bAutoRebalanceScheduled = false;
+
+		ServerRebalanceTeams(AutoRebalanceTolerance);
+	}));
+}
+
+int32 UTeamManagerComponent::ServerRebalanceTeams(int32 Tolerance)
+{
+	if (!GetOwner()->HasAuthority() || !TeamCreationData)
+	{
+		return 0;
+	}
+
+	auto TeamAssign{ TeamCreationData->TeamAssignType };
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) };
+
+	if (!ensure(TeamAssign) || !ensure(TMS))
+	{
+		return 0;
+	}
+
+	TArray<FTeamRebalanceMove> Moves;
+	TeamAssign->ComputeRebalanceMoves(TeamCreationData, TMS, Tolerance, Moves);
+
+	auto NumMoved{ 0 };
+
+	for (const auto& Move : Moves)
+	{
+		if (TMS->ChangeTeamForActor(Move.PlayerState, Move.ToTeamId))
+		{
+			NumMoved++;
+		}
+	}
+
+	if (NumMoved > 0)
+	{
+		UE_LOG(LogGameExt_Team, Log, TEXT("Rebalanced teams by moving %d players (Tolerance: %d)"), NumMoved, Tolerance);
+	}
+
+	return NumMoved;
+}
+
+
+// Assignment Queue
+
+void UTeamManagerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (ProcessAssignmentQueue(AssignmentBudgetMs))
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UTeamManagerComponent::QueueAssignment(APlayerState* PS)
+{
+	check(PS);
+
+	PendingAssignments.Add(PS);
+
+	SetComponentTickEnabled(true);
+}
+
+bool UTeamManagerComponent::ProcessAssignmentQueue(double BudgetMs)
+{
+	const auto StartCycles{ FPlatformTime::Cycles64() };
+
+	// Assign players in the order they logged in, so the result is the same as assigning them on login
+
+	while (PendingAssignmentHead < PendingAssignments.Num())
+	{
+		if (auto* PlayerState{ PendingAssignments[PendingAssignmentHead++].Get() })
+		{
+			ServerChooseTeamForPlayer(PlayerState);
+		}
+
+		if (FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) >= BudgetMs)
+		{
+			break;
+		}
+	}
+
+	// Release the processed players once the queue is empty
+
+	if (PendingAssignmentHead >= PendingAssignments.Num())
+	{
+		PendingAssignments.Reset();
+		PendingAssignmentHead = 0;
+
+		return true;
+	}
+
+	return false;
+}
+
+void UTeamManagerComponent::FlushAssignmentQueue()
+{
+	ProcessAssignmentQueue(TNumericLimits<double>::Max());
+
+	SetComponentTickEnabled(false);
+}
+
+
+// Roster Replication
+
+void UTeamManagerComponent::StartRosterReplication()
+{
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) };
+
+	if (!TMS || PlayerRosterChangedHandle.IsValid())
+	{
+		return;
+	}
+
+	TMS->ForEachPlayerInRoster([this](APlayerState* PlayerState, FGenericTeamId TeamId)
+	{
+		Roster.SetPlayerTeam(PlayerState, TeamId);
+	});
+
+	PlayerRosterChangedHandle = TMS->OnPlayerRosterChangedNative.AddUObject(this, &ThisClass::HandlePlayerRosterChanged);
+}
+
+void UTeamManagerComponent::StopRosterReplication()
+{
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TMS->OnPlayerRosterChangedNative.Remove(PlayerRosterChangedHandle);
+	}
+
+	PlayerRosterChangedHandle.Reset();
+}
+
+void UTeamManagerComponent::HandlePlayerRosterChanged(APlayerState* PlayerState, FGenericTeamId TeamId)
+{
+	Roster.SetPlayerTeam(PlayerState, TeamId);
+}
@@ -5,9 +5,14 @@
 #include "Components/GameStateComponent.h"
 #include "Components/GameFrameworkInitStateInterface.h"
 
+#include "Replication/TeamRosterList.h"
+
 #include "TeamManagerComponent.generated.h"
 
 class UTeamCreationData;
+class AGameModeBase;
+class AController;
+class APlayerState;
 
 
 UCLASS(meta = (BlueprintSpawnableComponent))
@@ -30,6 +35,7 @@ protected:
 	virtual void OnRegister() override;
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
 public:
 	virtual FName GetFeatureName() const override { return NAME_ActorFeatureName; }
@@ -94,4 +100,128 @@ protected:
 	 */
 	virtual void ServerChooseTeamForPlayer(APlayerState* PS);
 
+	/**
+	 * Sets the team IDs of the players that already exist when the teams are created
+	 * 
+	 * Tips:
+	 *	By default, assigned together through UTeamAssignBase::AssignTeamsForPlayers.
+	 *	Override this as well when overriding ServerChooseTeamForPlayer to apply the same rule to these players
+	 */
+	virtual void ServerChooseTeamsForPlayers(TArrayView<APlayerState* const> PlayerStates);
+
+
+	////////////////////////////////////////////////////
+	// Rebalance
+protected:
+	//
+	// Whether teams are rebalanced automatically after a player logs out
+	//
+	UPROPERTY(EditAnywhere, Category = "Rebalance")
+	bool bAutoRebalanceOnLogout{ false };
+
+	//
+	// Maximum difference in population between the largest and smallest team allowed by automatic rebalancing
+	//
+	UPROPERTY(EditAnywhere, Category = "Rebalance", meta = (EditCondition = "bAutoRebalanceOnLogout", ClampMin = 1))
+	int32 AutoRebalanceTolerance{ 1 };
+
+	bool bAutoRebalanceScheduled{ false };
+
+protected:
+	void OnLogout(AGameModeBase* GameMode, AController* Exiting);
+
+public:
+	/**
+	 * Move the fewest players needed to bring the team populations within the tolerance and returns the number of players moved
+	 * 
+	 * Tips:
+	 *	All moves are applied in the same frame, so they are broadcast together by UTeamManagerSubsystem::OnTeamMembersChanged
+	 */
+	UFUNCTION(BlueprintAuthorityOnly, BlueprintCallable)
+	int32 ServerRebalanceTeams(int32 Tolerance = 1);
+
+
+	////////////////////////////////////////////////////
+	// Assignment Queue
+protected:
+	//
+	// Whether players logging in are queued and assigned over multiple frames instead of immediately
+	//
+	UPROPERTY(EditAnywhere, Category = "Assignment")
+	bool bUseAssignmentQueue{ false };
+
+	//
+	// Time in milliseconds that can be spent assigning queued players per frame
+	// 
+	// Tips:
+	//	At least one player is assigned per frame regardless of the budget
+	//
+	UPROPERTY(EditAnywhere, Category = "Assignment", meta = (EditCondition = "bUseAssignmentQueue", ClampMin = 0.0, Units = "ms"))
+	float AssignmentBudgetMs{ 1.0f };
+
+	//
+	// Players waiting for team assignment in the order they logged in
+	//
+	TArray<TWeakObjectPtr<APlayerState>> PendingAssignments;
+
+	//
+	// Index of the next player in PendingAssignments to be assigned
+	//
+	int32 PendingAssignmentHead{ 0 };
+
+protected:
+	/**
+	 * Add the player to the end of the assignment queue
+	 */
+	void QueueAssignment(APlayerState* PS);
+
+	/**
+	 * Assign queued players until the time budget runs out, returns true if the queue is empty
+	 */
+	bool ProcessAssignmentQueue(double BudgetMs);
+
+public:
+	/**
+	 * Assign all queued players immediately
+	 */
+	UFUNCTION(BlueprintAuthorityOnly, BlueprintCallable)
+	void FlushAssignmentQueue();
+
+	/**
+	 * Returns the number of players waiting for team assignment
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 GetNumPendingAssignments() const { return PendingAssignments.Num() - PendingAssignmentHead; }
+
+
+	////////////////////////////////////////////////////
+	// Roster Replication
+protected:
+	//
+	// Whether the team of every player state is replicated to clients as a single roster
+	// 
+	// Tips:
+	//	Clients then know every team membership through this component alone,
+	//	without depending on the relevancy of each player state and pawn
+	//
+	UPROPERTY(EditAnywhere, Category = "Roster")
+	bool bReplicateRoster{ false };
+
+	UPROPERTY(Replicated)
+	FTeamRosterList Roster;
+
+	FDelegateHandle PlayerRosterChangedHandle;
+
+protected:
+	/**
+	 * Fill the roster with the current players and keep it updated from UTeamManagerSubsystem
+	 */
+	void StartRosterReplication();
+	void StopRosterReplication();
+
+	void HandlePlayerRosterChanged(APlayerState* PlayerState, FGenericTeamId TeamId);
+
+public:
+	const FTeamRosterList& GetRoster() const { return Roster; }
+
 };
@@ -9,10 +9,25 @@
 #include "TeamMemberComponent.h"
 #include "TeamFunctionLibrary.h"
 #include "TeamCreationData.h"
+#include "TeamDisplayData.h"
+#include "TeamMemberComponentInterface.h"
+#include "TeamStateSnapshotSubsystem.h"
+#include "Replication/TeamNetConditionGroups.h"
 #include "GTExtLogs.h"
 
 #include "GenericTeamAgentInterface.h"
 #include "GameFramework/GameStateBase.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/HitResult.h"
+#include "WorldCollision.h"
+#include "TimerManager.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetConnection.h"
+#include "Components/MeshComponent.h"
+#include "Materials/MaterialInstanceDynamic.h"
 
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(TeamManagerSubsystem)
@@ -21,327 +36,1431 @@
 void UTeamManagerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
+
+	FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &ThisClass::HandleGameModePostLogin);
+	FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &ThisClass::HandleGameModeLogout);
+}
+
+void UTeamManagerSubsystem::Deinitialize()
+{
+	FGameModeEvents::GameModePostLoginEvent.RemoveAll(this);
+	FGameModeEvents::GameModeLogoutEvent.RemoveAll(this);
+	FWorldDelegates::OnWorldPostActorTick.RemoveAll(this);
+
+	if (auto* World{ GetWorld() })
+	{
+		World->GetTimerManager().ClearTimer(TeamMaterialPoolSweepTimerHandle);
+	}
+
+	IrisReplicationFilter.Deinit();
+
+	MemberRegistry.Reset();
+	SpatialHash.Reset();
+	ViewerTeamIds.Reset();
+	PlayerRosterTeamIds.Reset();
+
+	TeamMaterialPool.Reset();
+	TeamMaterialPoolKeys.Reset();
+	PooledTeamMaterials.Reset();
+
+	PendingTeamMemberChanges.Reset();
+	PendingTeamMemberChangeIndices.Reset();
+
+	GameModeOptionIndex.Reset();
+	RestoredTeamState.Reset();
+	bTeamStateRestoreChecked = false;
+
+	Super::Deinitialize();
+}
+
+void UTeamManagerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Take the team state carried over from the previous map right away so it is never left for a later map
+
+	if (InWorld.IsGameWorld() && (InWorld.GetNetMode() != NM_Client))
+	{
+		RestoreTeamState();
+	}
+
+	// Start team scoped filtering of actors that have been registered so far when replicating with Iris
+
+	if (IrisReplicationFilter.Init(this, &InWorld))
+	{
+		for (auto Index{ 0 }; Index < MemberRegistry.Num(); ++Index)
+		{
+			auto* Member{ MemberRegistry.GetMember(Index) };
+
+			if (Member->ReplicationPolicy != ETeamReplicationPolicy::PublicToAll)
+			{
+				IrisReplicationFilter.SetActorScope(Member->GetOwner(), Member->ReplicationPolicy, Member->GetGenericTeamId());
+			}
+
+			UpdateViewerTeam(Member, Member->GetGenericTeamId());
+		}
+
+		TeamTable.ForEachTeam([this](int32 TeamId, const FTeamTrackingInfo& TrackingInfo)
+		{
+			for (ATeamInfoBase* TeamInfo : { static_cast<ATeamInfoBase*>(TrackingInfo.PublicInfo), static_cast<ATeamInfoBase*>(TrackingInfo.PrivateInfo) })
+			{
+				if (TeamInfo && (TeamInfo->GetTeamReplicationPolicy() != ETeamReplicationPolicy::PublicToAll))
+				{
+					IrisReplicationFilter.SetActorScope(TeamInfo, TeamInfo->GetTeamReplicationPolicy(), UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId));
+				}
+			}
+		});
+
+		FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ThisClass::HandleWorldPostActorTick);
+	}
+}
+
+
+void UTeamManagerSubsystem::RegisterTeamInfo(ATeamInfoBase* TeamInfo)
+{
+	check(TeamInfo);
+
+	const auto TeamId{ TeamInfo->GetTeamId() };
+	check(TeamId != INDEX_NONE);
+
+	const auto bNewTeam{ !TeamTable.Contains(TeamId) };
+
+	auto& Entry{ TeamTable.FindOrAdd(TeamId) };
+	const auto* OldDisplayData{ Entry.DisplayData.Get() };
+
+	Entry.SetTeamInfo(TeamInfo);
+
+	if (Entry.DisplayData != OldDisplayData)
+	{
+		TeamDisplayDataChangedDelegates[TeamId].Broadcast(Entry.DisplayData);
+	}
+
+	if (TeamInfo->GetTeamReplicationPolicy() != ETeamReplicationPolicy::PublicToAll)
+	{
+		IrisReplicationFilter.SetActorScope(TeamInfo, TeamInfo->GetTeamReplicationPolicy(), UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId));
+	}
+
+	if (bNewTeam)
+	{
+		RebuildTeamRelationshipCache();
+	}
+}
+
+void UTeamManagerSubsystem::UnregisterTeamInfo(ATeamInfoBase* TeamInfo)
+{
+	check(TeamInfo);
+
+	const auto TeamId{ TeamInfo->GetTeamId() };
+	check(TeamId != INDEX_NONE);
+
+	auto& Entry{ TeamTable.FindChecked(TeamId) };
+	Entry.RemoveTeamInfo(TeamInfo);
+
+	IrisReplicationFilter.RemoveActor(TeamInfo);
+}
+
+void UTeamManagerSubsystem::NotifyTeamDisplayDataModified(UTeamDisplayData* ModifiedData)
+{
+	if (!ModifiedData)
+	{
+		return;
+	}
+
+	RefreshTeamMaterials(ModifiedData);
+
+	// Only teams using the modified data need to update
+
+	TeamTable.ForEachTeam([this, ModifiedData](int32 TeamId, const FTeamTrackingInfo& TrackingInfo)
+	{
+		if (TrackingInfo.DisplayData == ModifiedData)
+		{
+			TeamDisplayDataChangedDelegates[TeamId].Broadcast(TrackingInfo.DisplayData);
+		}
+	});
+}
+
+
+// Team Attitudes
+
+void UTeamManagerSubsystem::ApplyTeamAttitudes(const UTeamCreationData* TeamCreationData)
+{
+	check(TeamCreationData);
+
+	AttitudeMatrix.Reset(TeamCreationData->DefaultTeamAttitude);
+
+	for (const auto& Setting : TeamCreationData->TeamAttitudes)
+	{
+		AttitudeMatrix.Set(FGenericTeamId(Setting.TeamA), FGenericTeamId(Setting.TeamB), Setting.Attitude);
+
+		if (Setting.bMutual)
+		{
+			AttitudeMatrix.Set(FGenericTeamId(Setting.TeamB), FGenericTeamId(Setting.TeamA), Setting.Attitude);
+		}
+	}
+
+	RebuildTeamRelationshipCache();
+}
+
+void UTeamManagerSubsystem::SetTeamAttitude(int32 TeamA, int32 TeamB, TEnumAsByte<ETeamAttitude::Type> Attitude, bool bMutual)
+{
+	const auto TeamIdA{ UTeamFunctionLibrary::IntegerToGenericTeamId(TeamA) };
+	const auto TeamIdB{ UTeamFunctionLibrary::IntegerToGenericTeamId(TeamB) };
+
+	AttitudeMatrix.Set(TeamIdA, TeamIdB, Attitude);
+
+	if (bMutual)
+	{
+		AttitudeMatrix.Set(TeamIdB, TeamIdA, Attitude);
+	}
+
+	RebuildTeamRelationshipCache();
+}
+
+TEnumAsByte<ETeamAttitude::Type> UTeamManagerSubsystem::GetTeamAttitude(int32 TeamA, int32 TeamB) const
+{
+	return AttitudeMatrix.Get(UTeamFunctionLibrary::IntegerToGenericTeamId(TeamA), UTeamFunctionLibrary::IntegerToGenericTeamId(TeamB));
+}
+
+
+// Team Members
+
+void UTeamManagerSubsystem::RegisterTeamMember(UTeamMemberComponent* Member)
+{
+	check(Member);
+
+	MemberRegistry.Add(Member);
+
+	UpdateViewerTeam(Member, Member->GetGenericTeamId());
+	UpdatePlayerRoster(Member, Member->GetGenericTeamId());
+
+	// Joining with a team is a change from no team, as is the pawn of a player state joining
+
+	QueueTeamMemberChange(Member->GetOwner(), FGenericTeamId::NoTeam, Member->GetGenericTeamId());
+
+	if (auto* PlayerState{ Cast<APlayerState>(Member->GetOwner()) })
+	{
+		PlayerState->OnPawnSet.AddUniqueDynamic(this, &ThisClass::HandlePlayerStatePawnSet);
+
+		QueueTeamMemberChange(PlayerState->GetPawn(), FGenericTeamId::NoTeam, Member->GetGenericTeamId());
+	}
+
+	if (Member->ReplicationPolicy != ETeamReplicationPolicy::PublicToAll)
+	{
+		IrisReplicationFilter.SetActorScope(Member->GetOwner(), Member->ReplicationPolicy, Member->GetGenericTeamId());
+	}
+
+	// Track the location of owners that can move
+
+	auto* Owner{ Member->GetOwner() };
+	auto* RootComponent{ Owner ? Owner->GetRootComponent() : nullptr };
+
+	if (Member->bTrackLocation && RootComponent && (Member->SpatialIndex == INDEX_NONE))
+	{
+		Member->SpatialIndex = SpatialHash.Add(Owner, Member->GetGenericTeamId(), RootComponent->GetComponentLocation());
+		Member->TrackedRootComponent = RootComponent;
+		Member->TransformUpdatedHandle = RootComponent->TransformUpdated.AddUObject(this, &ThisClass::HandleTeamMemberTransformUpdated, Member);
+	}
+}
+
+void UTeamManagerSubsystem::UnregisterTeamMember(UTeamMemberComponent* Member)
+{
+	check(Member);
+
+	MemberRegistry.Remove(Member);
+
+	if (auto* PlayerState{ Cast<APlayerState>(Member->GetOwner()) })
+	{
+		PlayerState->OnPawnSet.RemoveDynamic(this, &ThisClass::HandlePlayerStatePawnSet);
+	}
+
+	UpdateViewerTeam(Member, FGenericTeamId::NoTeam);
+	UpdatePlayerRoster(Member, FGenericTeamId::NoTeam);
+
+	if (Member->ReplicationPolicy != ETeamReplicationPolicy::PublicToAll)
+	{
+		IrisReplicationFilter.RemoveActor(Member->GetOwner());
+	}
+
+	if (Member->SpatialIndex != INDEX_NONE)
+	{
+		if (auto* RootComponent{ Member->TrackedRootComponent.Get() })
+		{
+			RootComponent->TransformUpdated.Remove(Member->TransformUpdatedHandle);
+		}
+
+		SpatialHash.Remove(Member->SpatialIndex);
+
+		Member->SpatialIndex = INDEX_NONE;
+		Member->TrackedRootComponent.Reset();
+		Member->TransformUpdatedHandle.Reset();
+	}
+}
+
+void UTeamManagerSubsystem::NotifyTeamMemberChanged(UTeamMemberComponent* Member, FGenericTeamId OldTeamId, FGenericTeamId NewTeamId)
+{
+	check(Member);
+
+	MemberRegistry.UpdateTeam(Member, NewTeamId);
+
+	UpdateViewerTeam(Member, NewTeamId);
+	UpdatePlayerRoster(Member, NewTeamId);
+
+	if (Member->ReplicationPolicy != ETeamReplicationPolicy::PublicToAll)
+	{
+		IrisReplicationFilter.SetActorScope(Member->GetOwner(), Member->ReplicationPolicy, NewTeamId);
+	}
+
+	if (Member->SpatialIndex != INDEX_NONE)
+	{
+		SpatialHash.SetTeam(Member->SpatialIndex, NewTeamId);
+	}
+
+	QueueTeamMemberChange(Member->GetOwner(), OldTeamId, NewTeamId);
+}
+
+void UTeamManagerSubsystem::QueueTeamMemberChange(AActor* Actor, FGenericTeamId OldTeamId, FGenericTeamId NewTeamId)
+{
+	if (!Actor)
+	{
+		return;
+	}
+
+	// Coalesce multiple changes of the same actor into one record that keeps the first old team and the latest new team
+
+	if (const auto* Index{ PendingTeamMemberChangeIndices.Find(Actor) })
+	{
+		PendingTeamMemberChanges[*Index].NewTeamId = UTeamFunctionLibrary::GenericTeamIdToInteger(NewTeamId);
+	}
+	else
+	{
+		const auto NewIndex{ PendingTeamMemberChanges.Emplace(Actor, UTeamFunctionLibrary::GenericTeamIdToInteger(OldTeamId), UTeamFunctionLibrary::GenericTeamIdToInteger(NewTeamId)) };
+		PendingTeamMemberChangeIndices.Add(Actor, NewIndex);
+	}
+
+	// Broadcast once at the next tick
+
+	if (!bTeamMemberChangeFlushScheduled)
+	{
+		if (auto* World{ GetWorld() })
+		{
+			bTeamMemberChangeFlushScheduled = true;
+
+			World->GetTimerManager().SetTimerForNextTick(this, &ThisClass::FlushTeamMemberChanges);
+		}
+	}
+}
+
+void UTeamManagerSubsystem::HandlePlayerStatePawnSet(APlayerState* PlayerState, APawn* NewPawn, APawn* OldPawn)
+{
+	const auto TeamId{ FindGenericTeamFromActor(PlayerState) };
+
+	QueueTeamMemberChange(NewPawn, FGenericTeamId::NoTeam, TeamId);
+
+	if (OldPawn)
+	{
+		QueueTeamMemberChange(OldPawn, TeamId, FindGenericTeamFromActor(OldPawn));
+	}
+}
+
+void UTeamManagerSubsystem::FlushTeamMemberChanges()
+{
+	bTeamMemberChangeFlushScheduled = false;
+
+	// Drop actors that have been destroyed or changed back to their original team
+
+	PendingTeamMemberChanges.RemoveAll([](const FTeamMemberChangeRecord& Record)
+	{
+		return !IsValid(Record.Actor) || (Record.OldTeamId == Record.NewTeamId);
+	});
+
+	PendingTeamMemberChangeIndices.Reset();
+
+	if (PendingTeamMemberChanges.IsEmpty())
+	{
+		return;
+	}
+
+	// Move out the records so that changes made by listeners are queued for the next batch
+
+	auto Records{ MoveTemp(PendingTeamMemberChanges) };
+	PendingTeamMemberChanges.Reset();
+
+	OnTeamMembersChangedNative.Broadcast(Records);
+	OnTeamMembersChanged.Broadcast(Records);
+}
+
+void UTeamManagerSubsystem::NotifyTeamMemberActiveChanged(UTeamMemberComponent* Member)
+{
+	check(Member);
+
+	MemberRegistry.RefreshActive(Member);
+}
+
+void UTeamManagerSubsystem::UpdateViewerTeam(const UTeamMemberComponent* Member, FGenericTeamId TeamId)
+{
+	const auto* PlayerState{ Cast<APlayerState>(Member->GetOwner()) };
+	auto* Viewer{ PlayerState ? PlayerState->GetOwner() : nullptr };
+
+	if (!Viewer)
+	{
+		return;
+	}
+
+	const auto* OldTeamId{ ViewerTeamIds.Find(Viewer) };
+	const auto OldGroupName{ FTeamNetConditionGroups::GetTeamGroupName(OldTeamId ? *OldTeamId : FGenericTeamId::NoTeam) };
+
+	if (TeamId != FGenericTeamId::NoTeam)
+	{
+		ViewerTeamIds.Add(Viewer, TeamId);
+	}
+	else
+	{
+		ViewerTeamIds.Remove(Viewer);
+	}
+
+	auto* PlayerController{ Cast<APlayerController>(Viewer) };
+	if (!PlayerController || !PlayerController->HasAuthority())
+	{
+		return;
+	}
+
+	// Team only subobjects are replicated to the connection through the net condition group of its team
+
+	const auto NewGroupName{ FTeamNetConditionGroups::GetTeamGroupName(TeamId) };
+	if (OldGroupName != NewGroupName)
+	{
+		if (!OldGroupName.IsNone())
+		{
+			PlayerController->RemoveFromNetConditionGroup(OldGroupName);
+		}
+
+		if (!NewGroupName.IsNone())
+		{
+			PlayerController->IncludeInNetConditionGroup(NewGroupName);
+		}
+	}
+
+	// Iris filters by connection instead of by viewer
+
+	if (IrisReplicationFilter.IsActive())
+	{
+		if (auto* Connection{ PlayerController->GetNetConnection() })
+		{
+			IrisReplicationFilter.SetConnectionTeam(Connection->GetConnectionId(), TeamId);
+		}
+	}
+}
+
+void UTeamManagerSubsystem::RemoveStaleViewerTeams()
+{
+	for (auto It{ ViewerTeamIds.CreateIterator() }; It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+FGenericTeamId UTeamManagerSubsystem::FindViewerTeam(const AActor* Viewer) const
+{
+	if (!Viewer)
+	{
+		return FGenericTeamId::NoTeam;
+	}
+
+	if (const auto* TeamId{ ViewerTeamIds.Find(Viewer) })
+	{
+		return *TeamId;
+	}
+
+	// The controller may not own its player state yet (e.g., right after seamless travel)
+
+	if (const auto* Controller{ Cast<AController>(Viewer) })
+	{
+		return FindGenericTeamFromActor(Controller->PlayerState);
+	}
+
+	return FGenericTeamId::NoTeam;
+}
+
+void UTeamManagerSubsystem::HandleGameModePostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer)
+{
+	// Reconnecting players get their inactive player state back, so it needs to be counted again
+
+	if (GameMode && (GameMode->GetWorld() == GetWorld()) && NewPlayer)
+	{
+		RemoveStaleViewerTeams();
+
+		if (auto* TMC{ FindTeamMemberComponent(NewPlayer->PlayerState) })
+		{
+			MemberRegistry.RefreshActive(TMC);
+
+			// The connection of the player is known from here on
+
+			UpdateViewerTeam(TMC, TMC->GetGenericTeamId());
+		}
+	}
+}
+
+void UTeamManagerSubsystem::HandleGameModeLogout(AGameModeBase* GameMode, AController* Exiting)
+{
+	if (!GameMode || (GameMode->GetWorld() != GetWorld()))
+	{
+		return;
+	}
+
+	// The controller no longer views anything, and may be destroyed before its player state unregisters
+
+	ViewerTeamIds.Remove(Exiting);
+
+	if (IrisReplicationFilter.IsActive())
+	{
+		if (auto* Connection{ Exiting ? Exiting->GetNetConnection() : nullptr })
+		{
+			IrisReplicationFilter.RemoveConnection(Connection->GetConnectionId());
+		}
+	}
+
+	auto* PlayerState{ Exiting ? Exiting->PlayerState.Get() : nullptr };
+
+	// Same resolution as IsActiveMember, which follows redirects of the player state
+
+	if (auto* TMC{ UTeamFunctionLibrary::GetTeamMemberComponentFromActor(PlayerState) })
+	{
+		MemberRegistry.RefreshActive(TMC);
+	}
+
+	// The player state kept for reconnection is made inactive after the logout event, so it is checked again on the next tick
+
+	if (auto* World{ GetWorld() }; World && PlayerState)
+	{
+		World->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this, WeakPlayerState = TWeakObjectPtr<APlayerState>(PlayerState)]()
+		{
+			if (auto* TMC{ UTeamFunctionLibrary::GetTeamMemberComponentFromActor(WeakPlayerState.Get()) })
+			{
+				MemberRegistry.RefreshActive(TMC);
+			}
+		}));
+	}
+}
+
+void UTeamManagerSubsystem::HandleTeamMemberTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport, UTeamMemberComponent* Member)
+{
+	check(Member);
+
+	SpatialHash.Move(Member->SpatialIndex, UpdatedComponent->GetComponentLocation());
+}
+
+UTeamMemberComponent* UTeamManagerSubsystem::FindTeamMemberComponent(const AActor* Actor) const
+{
+	if (!Actor)
+	{
+		return nullptr;
+	}
+
+	if (auto* Member{ MemberRegistry.FindByActor(Actor) })
+	{
+		return Member;
+	}
+
+	// Every component registers itself on registration, so only actors redirecting through the interface remain
+
+	if (const auto* TMCI{ Cast<ITeamMemberComponentInterface>(Actor) })
+	{
+		return TMCI->GetTeamMemberComponent();
+	}
+
+	return nullptr;
+}
+
+FGenericTeamId UTeamManagerSubsystem::FindGenericTeamFromActor(const AActor* Actor) const
+{
+	const auto Index{ MemberRegistry.FindIndexByActor(Actor) };
+	if (Index != INDEX_NONE)
+	{
+		return MemberRegistry.GetMemberTeamId(Index);
+	}
+
+	if (const auto* TMC{ FindTeamMemberComponent(Actor) })
+	{
+		return TMC->GetGenericTeamId();
+	}
+
+	// Players whose team member has not replicated yet are still known from the player roster
+
+	const auto* Pawn{ Cast<APawn>(Actor) };
+	const auto* PlayerState{ Pawn ? Pawn->GetPlayerState() : Cast<APlayerState>(Actor) };
+
+	return PlayerState ? FindPlayerRosterTeam(PlayerState) : FGenericTeamId::NoTeam;
+}
+
+TConstArrayView<UTeamMemberComponent*> UTeamManagerSubsystem::GetMembersOfTeam(int32 TeamId) const
+{
+	return MemberRegistry.GetTeamRoster(UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId));
+}
+
+int32 UTeamManagerSubsystem::GetActiveMemberCountOfTeam(int32 TeamId) const
+{
+	return MemberRegistry.GetActiveMemberCount(UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId));
+}
+
+
+bool UTeamManagerSubsystem::ChangeTeamForActor(AActor* ActorToChange, int32 NewTeamId)
+{
+	const auto NewTeamID{ UTeamFunctionLibrary::IntegerToGenericTeamId(NewTeamId) };
+
+	if (auto* TMC{ FindTeamMemberComponent(ActorToChange) })
+	{
+		TMC->SetGenericTeamId(NewTeamID);
+
+		return true;
+	}
+
+	return false;
+}
+
+bool UTeamManagerSubsystem::CanCauseDamage(const AActor* Instigator, const AActor* Target, bool bAllowDamageToSelf) const
+{
+	// Whether or not you can do damage to yourself.
+
+	if (Instigator == Target)
+	{
+		return bAllowDamageToSelf;
+	}
+
+	// Whether both teams are hostile
+	// Teams are always friendly to themselves and no team is neutral to everyone, so a single lookup is enough
+
+	const auto InstigatorTeamId{ FindGenericTeamFromActor(Instigator) };
+	const auto TargetTeamId{ FindGenericTeamFromActor(Target) };
+
+	return AttitudeMatrix.Get(InstigatorTeamId, TargetTeamId) == ETeamAttitude::Hostile;
+}
+
+ETeamComparison UTeamManagerSubsystem::CompareTeams(const AActor* A, const AActor* B, int32& TeamIdA, int32& TeamIdB) const
+{
+	if (A == B)
+	{
+		TeamIdA = INDEX_NONE;
+		TeamIdB = INDEX_NONE;
+
+		return ETeamComparison::OnSameTeam;
+	}
+
+	const auto GenericTeamIdA{ FindGenericTeamFromActor(A) };
+	const auto GenericTeamIdB{ FindGenericTeamFromActor(B) };
+
+	TeamIdA = UTeamFunctionLibrary::GenericTeamIdToInteger(GenericTeamIdA);
+	TeamIdB = UTeamFunctionLibrary::GenericTeamIdToInteger(GenericTeamIdB);
+
+	if ((TeamIdA == INDEX_NONE) || (TeamIdB == INDEX_NONE))
+	{
+		return ETeamComparison::InvalidArgument;
+	}
+	else if (TeamIdA == TeamIdB)
+	{
+		return ETeamComparison::OnSameTeam;
+	}
+	else
+	{
+		return AttitudeToComparison(AttitudeMatrix.Get(GenericTeamIdA, GenericTeamIdB));
+	}
+}
+
+ETeamComparison UTeamManagerSubsystem::CompareTeams(const AActor* A, const AActor* B) const
+{
+	int32 TeamIdA;
+	int32 TeamIdB;
+
+	return CompareTeams(A, B, /*out*/ TeamIdA, /*out*/ TeamIdB);
+}
+
+template<typename GetActorFuncType>
+void UTeamManagerSubsystem::CanCauseDamageBatchInternal(const AActor* Instigator, int32 NumTargets, GetActorFuncType&& GetActorFunc, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf) const
+{
+	OutCanDamage.Init(false, NumTargets);
+
+	if (NumTargets <= 0)
+	{
+		return;
+	}
+
+	// Build a lookup of which teams the instigator is hostile to from its row of the attitude matrix
+
+	const auto* Row{ AttitudeMatrix.GetRow(FindGenericTeamFromActor(Instigator)) };
+
+	uint32 IsHostile[FTeamAttitudeMatrix::MaxTeams];
+	for (auto TeamId{ 0 }; TeamId < FTeamAttitudeMatrix::MaxTeams; ++TeamId)
+	{
+		IsHostile[TeamId] = (FTeamAttitudeMatrix::GetFromRow(Row, static_cast<uint8>(TeamId)) == ETeamAttitude::Hostile) ? 1u : 0u;
+	}
+
+	// Resolve the team of every target into a packed array, on the stack for typical hit counts so that the query stays reentrant
+
+	TArray<uint8, TInlineAllocator<256>> TeamIds;
+	TeamIds.SetNumUninitialized(NumTargets);
+
+	auto bHasSelf{ false };
+
+	for (auto Index{ 0 }; Index < NumTargets; ++Index)
+	{
+		const auto* Target{ GetActorFunc(Index) };
+
+		bHasSelf |= (Target == Instigator);
+		TeamIds[Index] = FindGenericTeamFromActor(Target).GetId();
+	}
+
+	// Gather the hostility of the packed team IDs without branches and store the results one word per 32 targets
+
+	auto* OutWords{ OutCanDamage.GetData() };
+	const auto* TeamIdData{ TeamIds.GetData() };
+
+	const auto NumFullWords{ NumTargets / 32 };
+	for (auto WordIndex{ 0 }; WordIndex < NumFullWords; ++WordIndex)
+	{
+		const auto* WordTeamIds{ TeamIdData + (WordIndex * 32) };
+
+		auto Word{ 0u };
+		for (auto Bit{ 0 }; Bit < 32; ++Bit)
+		{
+			Word |= IsHostile[WordTeamIds[Bit]] << Bit;
+		}
+
+		OutWords[WordIndex] = Word;
+	}
+
+	for (auto Index{ NumFullWords * 32 }; Index < NumTargets; ++Index)
+	{
+		OutWords[Index >> 5] |= IsHostile[TeamIdData[Index]] << (Index & 31);
+	}
+
+	// Teams are always friendly to themselves, so the instigator itself needs to be patched afterwards
+
+	if (bHasSelf)
+	{
+		for (auto Index{ 0 }; Index < NumTargets; ++Index)
+		{
+			if (GetActorFunc(Index) == Instigator)
+			{
+				OutCanDamage[Index] = bAllowDamageToSelf;
+			}
+		}
+	}
+}
+
+void UTeamManagerSubsystem::CanCauseDamageBatch(const AActor* Instigator, TArrayView<const AActor* const> Targets, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf) const
+{
+	CanCauseDamageBatchInternal(Instigator, Targets.Num(), [&Targets](int32 Index) { return Targets[Index]; }, OutCanDamage, bAllowDamageToSelf);
+}
+
+void UTeamManagerSubsystem::CanCauseDamageBatch(const AActor* Instigator, TArrayView<const FOverlapResult> Overlaps, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf) const
+{
+	CanCauseDamageBatchInternal(Instigator, Overlaps.Num(), [&Overlaps](int32 Index) { return Overlaps[Index].GetActor(); }, OutCanDamage, bAllowDamageToSelf);
+}
+
+void UTeamManagerSubsystem::CanCauseDamageBatch(const AActor* Instigator, TArrayView<const FHitResult> Hits, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf) const
+{
+	CanCauseDamageBatchInternal(Instigator, Hits.Num(), [&Hits](int32 Index) { return Hits[Index].GetActor(); }, OutCanDamage, bAllowDamageToSelf);
+}
+
+void UTeamManagerSubsystem::CompareTeamsBatch(const AActor* A, TArrayView<const AActor* const> Targets, TArray<ETeamComparison>& OutComparisons) const
+{
+	OutComparisons.SetNumUninitialized(Targets.Num());
+
+	const auto TeamIdA{ FindGenericTeamFromActor(A) };
+	const auto* Row{ AttitudeMatrix.GetRow(TeamIdA) };
+
+	for (auto Index{ 0 }; Index < Targets.Num(); ++Index)
+	{
+		const auto* Target{ Targets[Index] };
+		const auto TeamIdB{ FindGenericTeamFromActor(Target) };
+
+		if (Target == A)
+		{
+			OutComparisons[Index] = ETeamComparison::OnSameTeam;
+		}
+		else if ((TeamIdA == FGenericTeamId::NoTeam) || (TeamIdB == FGenericTeamId::NoTeam))
+		{
+			OutComparisons[Index] = ETeamComparison::InvalidArgument;
+		}
+		else if (TeamIdA == TeamIdB)
+		{
+			OutComparisons[Index] = ETeamComparison::OnSameTeam;
+		}
+		else
+		{
+			OutComparisons[Index] = AttitudeToComparison(FTeamAttitudeMatrix::GetFromRow(Row, TeamIdB.GetId()));
+		}
+	}
+}
+
+ETeamComparison UTeamManagerSubsystem::AttitudeToComparison(ETeamAttitude::Type Attitude)
+{
+	static constexpr ETeamComparison Comparisons[]
+	{
+		ETeamComparison::AlliedTeams,		// ETeamAttitude::Friendly
+		ETeamComparison::NeutralTeams,		// ETeamAttitude::Neutral
+		ETeamComparison::DifferentTeams,	// ETeamAttitude::Hostile
+		ETeamComparison::DifferentTeams,
+	};
+
+	return Comparisons[Attitude & 3];
+}
+
+void UTeamManagerSubsystem::AddTeamTagStack(int32 TeamId, FGameplayTag Tag, int32 StackCount)
+{
+	auto FailureHandler
+	{
+		[&](const FString& ErrorMessage)
+		{
+			UE_LOG(LogGameExt_Team, Error, TEXT("AddTeamTagStack(TeamId: %d, Tag: %s, StackCount: %d) %s"), TeamId, *Tag.ToString(), StackCount, *ErrorMessage);
+		}
+	};
+
+	if (auto* Entry{ TeamTable.Find(TeamId) })
+	{
+		if (Entry->PublicInfo)
+		{
+			if (Entry->PublicInfo->HasAuthority())
+			{
+				Entry->PublicInfo->AddTeamTagStack(Tag, StackCount);
+			}
+			else
+			{
+				FailureHandler(TEXT("failed because it was called on a client"));
+			}
+		}
+		else
+		{
+			FailureHandler(TEXT("failed because there is no team info spawned yet (called too early, before the experience was ready)"));
+		}
+	}
+	else
+	{
+		FailureHandler(TEXT("failed because it was passed an unknown team id"));
+	}
+}
+
+void UTeamManagerSubsystem::RemoveTeamTagStack(int32 TeamId, FGameplayTag Tag, int32 StackCount)
+{
+	auto FailureHandler
+	{
+		[&](const FString& ErrorMessage)
+		{
+			UE_LOG(LogGameExt_Team, Error, TEXT("RemoveTeamTagStack(TeamId: %d, Tag: %s, StackCount: %d) %s"), TeamId, *Tag.ToString(), StackCount, *ErrorMessage);
+		}
+	};
+
+	if (auto* Entry{ TeamTable.Find(TeamId) })
+	{
+		if (Entry->PublicInfo)
+		{
+			if (Entry->PublicInfo->HasAuthority())
+			{
+				Entry->PublicInfo->RemoveTeamTagStack(Tag, StackCount);
+			}
+			else
+			{
+				FailureHandler(TEXT("failed because it was called on a client"));
+			}
+		}
+		else
+		{
+			FailureHandler(TEXT("failed because there is no team info spawned yet (called too early, before the experience was ready)"));
+		}
+	}
+	else
+	{
+		FailureHandler(TEXT("failed because it was passed an unknown team id"));
+	}
+}
+
+void UTeamManagerSubsystem::SetTeamTagStack(int32 TeamId, FGameplayTag Tag, int32 StackCount)
+{
+	auto FailureHandler
+	{
+		[&](const FString& ErrorMessage)
+		{
+			UE_LOG(LogGameExt_Team, Error, TEXT("SetTeamTagStack(TeamId: %d, Tag: %s, StackCount: %d) %s"), TeamId, *Tag.ToString(), StackCount, *ErrorMessage);
+		}
+	};
+
+	if (auto* Entry{ TeamTable.Find(TeamId) })
+	{
+		if (Entry->PublicInfo)
+		{
+			if (Entry->PublicInfo->HasAuthority())
+			{
+				Entry->PublicInfo->SetTeamTagStack(Tag, StackCount);
+			}
+			else
+			{
+				FailureHandler(TEXT("failed because it was called on a client"));
+			}
+		}
+		else
+		{
+			FailureHandler(TEXT("failed because there is no team info spawned yet (called too early, before the experience was ready)"));
+		}
+	}
+	else
+	{
+		FailureHandler(TEXT("failed because it was passed an unknown team id"));
+	}
+}
+
+int32 UTeamManagerSubsystem::GetTeamTagStackCount(int32 TeamId, FGameplayTag Tag) const
+{
+	if (const auto* Entry{ TeamTable.Find(TeamId) })
+	{
+		const auto PublicStackCount{ (Entry->PublicInfo != nullptr) ? Entry->PublicInfo->GetTeamTagStackCount(Tag) : 0 };
+		const auto PrivateStackCount{ (Entry->PrivateInfo != nullptr) ? Entry->PrivateInfo->GetTeamTagStackCount(Tag) : 0 };
+
+		return PublicStackCount + PrivateStackCount;
+	}
+	else
+	{
+		UE_LOG(LogGameExt_Team, Log, TEXT("GetTeamTagStackCount(TeamId: %d, Tag: %s) failed because it was passed an unknown team id"), TeamId, *Tag.ToString());
+		
+		return 0;
+	}
+}
+
+bool UTeamManagerSubsystem::TeamHasTag(int32 TeamId, FGameplayTag Tag) const
+{
+	return GetTeamTagStackCount(TeamId, Tag) > 0;
+}
+
+bool UTeamManagerSubsystem::DoesTeamExist(int32 TeamId) const
+{
+	return TeamTable.Contains(TeamId);
+}
+
+
+FTeamDisplayDataChangedDelegate& UTeamManagerSubsystem::GetTeamDisplayDataChangedDelegate(int32 TeamId)
+{
+	if (!ensure(FTeamTrackingTable::IsValidTeamId(TeamId)))
+	{
+		InvalidTeamDisplayDataChangedDelegate.Clear();
+		return InvalidTeamDisplayDataChangedDelegate;
+	}
+
+	return TeamDisplayDataChangedDelegates[TeamId];
+}
+
+int32 UTeamManagerSubsystem::FindTeamFromActor(const AActor* TestActor) const
+{
+	return UTeamFunctionLibrary::GenericTeamIdToInteger(FindGenericTeamFromActor(TestActor));
+}
+
+void UTeamManagerSubsystem::BP_FindTeamFromActor(const AActor* TestActor, bool& bIsPartOfTeam, int32& TeamId) const
+{
+	TeamId = FindTeamFromActor(TestActor);
+	bIsPartOfTeam = TeamId != INDEX_NONE;
+}
+
+UTeamDisplayData* UTeamManagerSubsystem::GetTeamDisplayData(int32 TeamId, int32 ViewerTeamId)
+{
+	if (auto * Entry{ TeamTable.Find(TeamId) })
+	{
+		return Entry->DisplayData;
+	}
+
+	return nullptr;
+}
+
+UTeamDisplayData* UTeamManagerSubsystem::GetEffectiveTeamDisplayData(int32 TeamId, AActor* ViewerTeamAgent)
+{
+	return GetTeamDisplayData(TeamId, FindTeamFromActor(ViewerTeamAgent));
+}
+
+TArray<int32> UTeamManagerSubsystem::GetTeamIDs() const
+{
+	return TArray<int32>(GetTeamIDsView());
 }
 
-void UTeamManagerSubsystem::Deinitialize()
-{
-	Super::Deinitialize();
+TArray<int32> UTeamManagerSubsystem::GetEnemyTeamIDsFromActor(const AActor* TestActor) const
+{
+	return TArray<int32>(GetEnemyTeamIDs(FindTeamFromActor(TestActor)));
+}
+
+TArray<int32> UTeamManagerSubsystem::GetAllyTeamIDsFromActor(const AActor* TestActor) const
+{
+	return TArray<int32>(GetAllyTeamIDs(FindTeamFromActor(TestActor)));
+}
+
+TConstArrayView<int32> UTeamManagerSubsystem::GetEnemyTeamIDs(int32 TeamId) const
+{
+	// Out of range IDs would otherwise be truncated into another team
+
+	if ((TeamId != INDEX_NONE) && !FTeamTrackingTable::IsValidTeamId(TeamId))
+	{
+		return TConstArrayView<int32>();
+	}
+
+	const auto GenericTeamId{ UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId) };
+
+	if (GenericTeamId == FGenericTeamId::NoTeam)
+	{
+		return CachedTeamIds;
+	}
+
+	return CachedEnemyTeamIds[GenericTeamId.GetId()];
+}
+
+TConstArrayView<int32> UTeamManagerSubsystem::GetAllyTeamIDs(int32 TeamId) const
+{
+	if (!FTeamTrackingTable::IsValidTeamId(TeamId))
+	{
+		return TConstArrayView<int32>();
+	}
+
+	const auto GenericTeamId{ UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId) };
+
+	if (GenericTeamId == FGenericTeamId::NoTeam)
+	{
+		return TConstArrayView<int32>();
+	}
+
+	return CachedAllyTeamIds[GenericTeamId.GetId()];
+}
+
+void UTeamManagerSubsystem::RebuildTeamRelationshipCache()
+{
+	TeamTable.GetTeamIds(CachedTeamIds);
+
+	for (auto Index{ 0 }; Index < FTeamTrackingTable::MaxTeams; ++Index)
+	{
+		const FGenericTeamId TeamId{ static_cast<uint8>(Index) };
+		const auto* Row{ AttitudeMatrix.GetRow(TeamId) };
+
+		auto& EnemyTeamIds{ CachedEnemyTeamIds[Index] };
+		auto& AllyTeamIds{ CachedAllyTeamIds[Index] };
+
+		EnemyTeamIds.Reset();
+		AllyTeamIds.Reset();
+
+		for (const auto& OtherTeamId : CachedTeamIds)
+		{
+			if (OtherTeamId == Index)
+			{
+				continue;
+			}
+
+			const auto Attitude{ FTeamAttitudeMatrix::GetFromRow(Row, static_cast<uint8>(OtherTeamId)) };
+
+			if (Attitude == ETeamAttitude::Hostile)
+			{
+				EnemyTeamIds.Add(OtherTeamId);
+			}
+			else if (Attitude == ETeamAttitude::Friendly)
+			{
+				AllyTeamIds.Add(OtherTeamId);
+			}
+		}
+	}
+
+	IrisReplicationFilter.RefreshAlliances();
 }
 
 
-void UTeamManagerSubsystem::RegisterTeamInfo(ATeamInfoBase* TeamInfo)
+// Player Roster
+
+void UTeamManagerSubsystem::UpdatePlayerRoster(const UTeamMemberComponent* Member, FGenericTeamId TeamId)
 {
-	check(TeamInfo);
+	// Clients are fed by the replicated roster instead
 
-	const auto TeamId{ TeamInfo->GetTeamId() };
-	check(TeamId != INDEX_NONE);
+	auto* PlayerState{ Cast<APlayerState>(Member->GetOwner()) };
 
-	auto& Entry{ TeamMap.FindOrAdd(TeamId) };
-	Entry.SetTeamInfo(TeamInfo);
+	if (PlayerState && PlayerState->HasAuthority())
+	{
+		SetPlayerRosterTeam(PlayerState, TeamId);
+	}
 }
 
-void UTeamManagerSubsystem::UnregisterTeamInfo(ATeamInfoBase* TeamInfo)
+void UTeamManagerSubsystem::SetPlayerRosterTeam(APlayerState* PlayerState, FGenericTeamId TeamId)
 {
-	check(TeamInfo);
+	if (!PlayerState)
+	{
+		return;
+	}
 
-	const auto TeamId{ TeamInfo->GetTeamId() };
-	check(TeamId != INDEX_NONE);
+	if (TeamId == FGenericTeamId::NoTeam)
+	{
+		if (PlayerRosterTeamIds.Remove(PlayerState) <= 0)
+		{
+			return;
+		}
+	}
+	else
+	{
+		auto& RosterTeamId{ PlayerRosterTeamIds.FindOrAdd(PlayerState, FGenericTeamId::NoTeam) };
 
-	auto& Entry{ TeamMap.FindChecked(TeamId) };
-	Entry.RemoveTeamInfo(TeamInfo);
+		if (RosterTeamId == TeamId)
+		{
+			return;
+		}
+
+		RosterTeamId = TeamId;
+	}
+
+	OnPlayerRosterChangedNative.Broadcast(PlayerState, TeamId);
 }
 
-void UTeamManagerSubsystem::NotifyTeamDisplayDataModified(UTeamDisplayData* ModifiedData)
+FGenericTeamId UTeamManagerSubsystem::FindPlayerRosterTeam(const APlayerState* PlayerState) const
 {
-	for (const auto& KVP : TeamMap)
+	const auto* TeamId{ PlayerRosterTeamIds.Find(PlayerState) };
+	return TeamId ? *TeamId : FGenericTeamId::NoTeam;
+}
+
+void UTeamManagerSubsystem::GetPlayersOfTeam(int32 TeamId, TArray<APlayerState*>& OutPlayerStates) const
+{
+	OutPlayerStates.Reset();
+
+	const auto GenericTeamId{ UTeamFunctionLibrary::IntegerToGenericTeamId(TeamId) };
+
+	ForEachPlayerInRoster([&OutPlayerStates, GenericTeamId](APlayerState* PlayerState, FGenericTeamId RosterTeamId)
 	{
-		const auto& TeamId{ KVP.Key };
-		const auto& TrackingInfo{ KVP.Value };
+		if (RosterTeamId == GenericTeamId)
+		{
+			OutPlayerStates.Add(PlayerState);
+		}
+	});
+}
 
-		TrackingInfo.OnTeamDisplayDataChanged.Broadcast(TrackingInfo.DisplayData);
+
+// Team Scoped Replication
+
+void UTeamManagerSubsystem::HandleWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if ((World == GetWorld()) && IrisReplicationFilter.HasPendingActors())
+	{
+		IrisReplicationFilter.ProcessPendingActors();
 	}
 }
 
-
-bool UTeamManagerSubsystem::ChangeTeamForActor(AActor* ActorToChange, int32 NewTeamId)
+ETeamReplicationPolicy UTeamManagerSubsystem::GetActorReplicationPolicy(const AActor* Actor, FGenericTeamId& OutTeamId) const
 {
-	const auto NewTeamID{ UTeamFunctionLibrary::IntegerToGenericTeamId(NewTeamId) };
+	OutTeamId = FGenericTeamId::NoTeam;
 
-	if (auto* TMC{ UTeamFunctionLibrary::GetTeamMemberComponentFromActor(ActorToChange) })
+	if (const auto* TeamInfo{ Cast<ATeamInfoBase>(Actor) })
 	{
-		TMC->SetGenericTeamId(NewTeamID);
+		OutTeamId = UTeamFunctionLibrary::IntegerToGenericTeamId(TeamInfo->GetTeamId());
 
-		return true;
+		return TeamInfo->GetTeamReplicationPolicy();
 	}
 
-	return false;
+	if (const auto* Member{ MemberRegistry.FindByActor(Actor) })
+	{
+		OutTeamId = Member->GetGenericTeamId();
+
+		return Member->ReplicationPolicy;
+	}
+
+	return ETeamReplicationPolicy::PublicToAll;
 }
 
-bool UTeamManagerSubsystem::CanCauseDamage(const AActor* Instigator, const AActor* Target, bool bAllowDamageToSelf) const
+bool UTeamManagerSubsystem::IsReplicatedToViewerTeam(FGenericTeamId ViewerTeamId, FGenericTeamId ActorTeamId, ETeamReplicationPolicy Policy) const
 {
-	// Whether or not you can do damage to yourself.
-
-	if (bAllowDamageToSelf && (Instigator == Target))
+	switch (Policy)
 	{
+	case ETeamReplicationPolicy::PublicToAll:
 		return true;
+
+	case ETeamReplicationPolicy::TeamOnly:
+		return (ViewerTeamId != FGenericTeamId::NoTeam) && (ViewerTeamId == ActorTeamId);
+
+	case ETeamReplicationPolicy::AlliesOnly:
+		return (ViewerTeamId != FGenericTeamId::NoTeam) && (ActorTeamId != FGenericTeamId::NoTeam)
+			&& ((ViewerTeamId == ActorTeamId) || (AttitudeMatrix.Get(ViewerTeamId, ActorTeamId) == ETeamAttitude::Friendly));
+
+	default:
+		return false;
 	}
+}
+
 
-	// Whether both teams are different
+// Spatial Queries
+
+AActor* UTeamManagerSubsystem::FindNearestEnemy(int32 TeamId, FVector Origin, float Radius) const
+{
+	return SpatialHash.FindNearest(GetEnemyTeamIDs(TeamId), Origin, Radius);
+}
 
-	int32 InstigatorTeamId;
-	int32 TargetTeamId;
-	const auto Relationship{ CompareTeams(Instigator, Target, /*out*/ InstigatorTeamId, /*out*/ TargetTeamId) };
+void UTeamManagerSubsystem::GetAlliesInRadius(int32 TeamId, FVector Origin, float Radius, TArray<AActor*>& OutActors) const
+{
+	OutActors.Reset();
 
-	if (Relationship == ETeamComparison::DifferentTeams)
+	auto AddActor
 	{
-		return true;
+		[&OutActors](AActor* Actor)
+		{
+			OutActors.Add(Actor);
+		}
+	};
+
+	if (TeamId != INDEX_NONE)
+	{
+		const int32 OwnTeamIds[]{ TeamId };
+		ForEachMemberInRadius(OwnTeamIds, Origin, Radius, AddActor);
 	}
 
-	return false;
+	ForEachMemberInRadius(GetAllyTeamIDs(TeamId), Origin, Radius, AddActor);
 }
 
-ETeamComparison UTeamManagerSubsystem::CompareTeams(const AActor* A, const AActor* B, int32& TeamIdA, int32& TeamIdB) const
+int32 UTeamManagerSubsystem::CountEnemiesInBox(int32 TeamId, FBox Box) const
 {
-	if (A == B)
+	return SpatialHash.CountInBox(GetEnemyTeamIDs(TeamId), Box);
+}
+
+
+// Team Material Pool
+
+UMaterialInstanceDynamic* UTeamManagerSubsystem::ApplyTeamMaterial(UMeshComponent* MeshComponent, int32 MaterialIndex, UMaterialInterface* ParentMaterial, const UTeamDisplayData* DisplayData)
+{
+	if (!MeshComponent || !ParentMaterial || !DisplayData)
 	{
-		TeamIdA = INDEX_NONE;
-		TeamIdB = INDEX_NONE;
+		return nullptr;
+	}
 
-		return ETeamComparison::OnSameTeam;
+	const FTeamMaterialPoolKey Key{ ParentMaterial, DisplayData };
+	auto* CurrentMaterial{ Cast<UMaterialInstanceDynamic>(MeshComponent->GetMaterial(MaterialIndex)) };
+
+	// Already using the material
+
+	if (auto* Entry{ TeamMaterialPool.Find(Key) }; Entry && (Entry->Material == CurrentMaterial))
+	{
+		Entry->Users.Add({ MeshComponent, MaterialIndex });
+		return CurrentMaterial;
 	}
 
-	TeamIdA = FindTeamFromActor(A);
-	TeamIdB = FindTeamFromActor(B);
+	// Release the pooled material the slot used before, e.g., for another team
 
-	if ((TeamIdA == INDEX_NONE) || (TeamIdB == INDEX_NONE))
+	if (CurrentMaterial && IsPooledTeamMaterial(CurrentMaterial))
 	{
-		return ETeamComparison::InvalidArgument;
+		ReleaseTeamMaterial(CurrentMaterial, MeshComponent, MaterialIndex);
 	}
-	else
+
+	auto& Entry{ TeamMaterialPool.FindOrAdd(Key) };
+
+	if (!Entry.Material)
 	{
-		return (TeamIdA == TeamIdB) ? ETeamComparison::OnSameTeam : ETeamComparison::DifferentTeams;
+		Entry.Material = UMaterialInstanceDynamic::Create(ParentMaterial, this);
+		Entry.DisplayData = DisplayData;
+
+		DisplayData->ApplyToMaterial(Entry.Material);
+
+		TeamMaterialPoolKeys.Add(Entry.Material, Key);
+		PooledTeamMaterials.Add(Entry.Material);
+
+		if (auto* World{ GetWorld() }; World && !TeamMaterialPoolSweepTimerHandle.IsValid())
+		{
+			World->GetTimerManager().SetTimer(TeamMaterialPoolSweepTimerHandle, this, &ThisClass::SweepTeamMaterialPool, TeamMaterialPoolSweepInterval, true);
+		}
 	}
-}
 
-ETeamComparison UTeamManagerSubsystem::CompareTeams(const AActor* A, const AActor* B) const
-{
-	int32 TeamIdA;
-	int32 TeamIdB;
+	Entry.Users.Add({ MeshComponent, MaterialIndex });
 
-	return CompareTeams(A, B, /*out*/ TeamIdA, /*out*/ TeamIdB);
+	MeshComponent->SetMaterial(MaterialIndex, Entry.Material);
+
+	return Entry.Material;
 }
 
-void UTeamManagerSubsystem::AddTeamTagStack(int32 TeamId, FGameplayTag Tag, int32 StackCount)
+void UTeamManagerSubsystem::ReleaseTeamMaterials(UMeshComponent* MeshComponent)
 {
-	auto FailureHandler
+	if (!MeshComponent)
 	{
-		[&](const FString& ErrorMessage)
-		{
-			UE_LOG(LogGameExt_Team, Error, TEXT("AddTeamTagStack(TeamId: %d, Tag: %s, StackCount: %d) %s"), TeamId, *Tag.ToString(), StackCount, *ErrorMessage);
-		}
-	};
+		return;
+	}
 
-	if (auto* Entry{ TeamMap.Find(TeamId) })
+	const auto NumMaterials{ MeshComponent->GetNumMaterials() };
+
+	for (auto MaterialIndex{ 0 }; MaterialIndex < NumMaterials; ++MaterialIndex)
 	{
-		if (Entry->PublicInfo)
-		{
-			if (Entry->PublicInfo->HasAuthority())
-			{
-				Entry->PublicInfo->TeamTags.AddStack(Tag, StackCount);
-			}
-			else
-			{
-				FailureHandler(TEXT("failed because it was called on a client"));
-			}
-		}
-		else
+		if (auto* Material{ Cast<UMaterialInstanceDynamic>(MeshComponent->GetMaterial(MaterialIndex)) })
 		{
-			FailureHandler(TEXT("failed because there is no team info spawned yet (called too early, before the experience was ready)"));
+			ReleaseTeamMaterial(Material, MeshComponent, MaterialIndex);
 		}
 	}
-	else
-	{
-		FailureHandler(TEXT("failed because it was passed an unknown team id"));
-	}
 }
 
-void UTeamManagerSubsystem::RemoveTeamTagStack(int32 TeamId, FGameplayTag Tag, int32 StackCount)
+void UTeamManagerSubsystem::ReleaseTeamMaterial(UMaterialInstanceDynamic* Material, const UMeshComponent* MeshComponent, int32 MaterialIndex)
 {
-	auto FailureHandler
-	{
-		[&](const FString& ErrorMessage)
-		{
-			UE_LOG(LogGameExt_Team, Error, TEXT("RemoveTeamTagStack(TeamId: %d, Tag: %s, StackCount: %d) %s"), TeamId, *Tag.ToString(), StackCount, *ErrorMessage);
-		}
-	};
+	const auto* Key{ TeamMaterialPoolKeys.Find(Material) };
+	auto* Entry{ Key ? TeamMaterialPool.Find(*Key) : nullptr };
 
-	if (auto* Entry{ TeamMap.Find(TeamId) })
+	if (!Entry)
 	{
-		if (Entry->PublicInfo)
-		{
-			if (Entry->PublicInfo->HasAuthority())
-			{
-				Entry->PublicInfo->TeamTags.RemoveStack(Tag, StackCount);
-			}
-			else
-			{
-				FailureHandler(TEXT("failed because it was called on a client"));
-			}
-		}
-		else
-		{
-			FailureHandler(TEXT("failed because there is no team info spawned yet (called too early, before the experience was ready)"));
-		}
+		return;
 	}
-	else
+
+	Entry->Users.Remove({ MeshComponent, MaterialIndex });
+
+	if (Entry->Users.IsEmpty())
 	{
-		FailureHandler(TEXT("failed because it was passed an unknown team id"));
+		RemoveTeamMaterialPoolEntry(*Key);
 	}
 }
 
-void UTeamManagerSubsystem::SetTeamTagStack(int32 TeamId, FGameplayTag Tag, int32 StackCount)
+void UTeamManagerSubsystem::RemoveTeamMaterialPoolEntry(FTeamMaterialPoolKey Key)
 {
-	auto FailureHandler
+	FTeamMaterialPoolEntry Entry;
+
+	if (TeamMaterialPool.RemoveAndCopyValue(Key, Entry))
 	{
-		[&](const FString& ErrorMessage)
+		TeamMaterialPoolKeys.Remove(Entry.Material);
+		PooledTeamMaterials.RemoveSingleSwap(Entry.Material, /*bAllowShrinking*/ false);
+	}
+
+	if (TeamMaterialPool.IsEmpty())
+	{
+		if (auto* World{ GetWorld() })
 		{
-			UE_LOG(LogGameExt_Team, Error, TEXT("SetTeamTagStack(TeamId: %d, Tag: %s, StackCount: %d) %s"), TeamId, *Tag.ToString(), StackCount, *ErrorMessage);
+			World->GetTimerManager().ClearTimer(TeamMaterialPoolSweepTimerHandle);
 		}
-	};
 
-	if (auto* Entry{ TeamMap.Find(TeamId) })
+		TeamMaterialPoolSweepTimerHandle.Invalidate();
+	}
+}
+
+void UTeamManagerSubsystem::SweepTeamMaterialPool()
+{
+	TArray<FTeamMaterialPoolKey, TInlineAllocator<16>> UnusedKeys;
+
+	for (auto& KVP : TeamMaterialPool)
 	{
-		if (Entry->PublicInfo)
+		auto& Entry{ KVP.Value };
+
+		for (auto It{ Entry.Users.CreateIterator() }; It; ++It)
 		{
-			if (Entry->PublicInfo->HasAuthority())
-			{
-				Entry->PublicInfo->TeamTags.SetStack(Tag, StackCount);
-			}
-			else
+			const auto* MeshComponent{ It->Key.Get() };
+
+			if (!MeshComponent || (MeshComponent->GetMaterial(It->Value) != Entry.Material))
 			{
-				FailureHandler(TEXT("failed because it was called on a client"));
+				It.RemoveCurrent();
 			}
 		}
-		else
+
+		if (Entry.Users.IsEmpty())
 		{
-			FailureHandler(TEXT("failed because there is no team info spawned yet (called too early, before the experience was ready)"));
+			UnusedKeys.Add(KVP.Key);
 		}
 	}
-	else
+
+	for (const auto& Key : UnusedKeys)
 	{
-		FailureHandler(TEXT("failed because it was passed an unknown team id"));
+		RemoveTeamMaterialPoolEntry(Key);
 	}
 }
 
-int32 UTeamManagerSubsystem::GetTeamTagStackCount(int32 TeamId, FGameplayTag Tag) const
+void UTeamManagerSubsystem::RefreshTeamMaterials(const UTeamDisplayData* DisplayData)
 {
-	if (const auto* Entry{ TeamMap.Find(TeamId) })
-	{
-		const auto PublicStackCount{ (Entry->PublicInfo != nullptr) ? Entry->PublicInfo->TeamTags.GetStackCount(Tag) : 0 };
-		const auto PrivateStackCount{ (Entry->PrivateInfo != nullptr) ? Entry->PrivateInfo->TeamTags.GetStackCount(Tag) : 0 };
-
-		return PublicStackCount + PrivateStackCount;
-	}
-	else
+	for (const auto& KVP : TeamMaterialPool)
 	{
-		UE_LOG(LogGameExt_Team, Log, TEXT("GetTeamTagStackCount(TeamId: %d, Tag: %s) failed because it was passed an unknown team id"), TeamId, *Tag.ToString());
-		
-		return 0;
+		if (KVP.Value.DisplayData == DisplayData)
+		{
+			DisplayData->ApplyToMaterial(KVP.Value.Material);
+		}
 	}
 }
 
-bool UTeamManagerSubsystem::TeamHasTag(int32 TeamId, FGameplayTag Tag) const
+bool UTeamManagerSubsystem::IsPooledTeamMaterial(const UMaterialInterface* Material) const
 {
-	return GetTeamTagStackCount(TeamId, Tag) > 0;
+	const auto* DynamicMaterial{ Cast<UMaterialInstanceDynamic>(Material) };
+	return DynamicMaterial && TeamMaterialPoolKeys.Contains(DynamicMaterial);
 }
 
-bool UTeamManagerSubsystem::DoesTeamExist(int32 TeamId) const
-{
-	return TeamMap.Contains(TeamId);
-}
 
+// Game Mode Option
 
-FTeamDisplayDataChangedDelegate& UTeamManagerSubsystem::GetTeamDisplayDataChangedDelegate(int32 TeamId)
+const FTeamGameModeOptionIndex& UTeamManagerSubsystem::GetGameModeOptionIndex(const AGameModeBase* GameMode)
 {
-	return TeamMap.FindOrAdd(TeamId).OnTeamDisplayDataChanged;
-}
+	if (GameMode)
+	{
+		RestoreTeamState();
 
-int32 UTeamManagerSubsystem::FindTeamFromActor(const AActor* TestActor) const
-{
-	if (auto* TMC{ UTeamFunctionLibrary::GetTeamMemberComponentFromActor(TestActor) })
+		GameModeOptionIndex.Update(GameMode->OptionsString, RestoredTeamState.IsEmpty() ? nullptr : &RestoredTeamState);
+	}
+	else
 	{
-		return UTeamFunctionLibrary::GenericTeamIdToInteger(TMC->GetGenericTeamId());
+		GameModeOptionIndex.Reset();
 	}
 
-	return INDEX_NONE;
-}
-
-void UTeamManagerSubsystem::BP_FindTeamFromActor(const AActor* TestActor, bool& bIsPartOfTeam, int32& TeamId) const
-{
-	TeamId = FindTeamFromActor(TestActor);
-	bIsPartOfTeam = TeamId != INDEX_NONE;
+	return GameModeOptionIndex;
 }
 
-UTeamDisplayData* UTeamManagerSubsystem::GetTeamDisplayData(int32 TeamId, int32 ViewerTeamId)
+void UTeamManagerSubsystem::RestoreTeamState()
 {
-	if (auto * Entry{ TeamMap.Find(TeamId) })
+	if (bTeamStateRestoreChecked)
 	{
-		return Entry->DisplayData;
+		return;
 	}
 
-	return nullptr;
-}
-
-UTeamDisplayData* UTeamManagerSubsystem::GetEffectiveTeamDisplayData(int32 TeamId, AActor* ViewerTeamAgent)
-{
-	return GetTeamDisplayData(TeamId, FindTeamFromActor(ViewerTeamAgent));
-}
+	bTeamStateRestoreChecked = true;
 
-TArray<int32> UTeamManagerSubsystem::GetTeamIDs() const
-{
-	TArray<int32> Result;
-	TeamMap.GenerateKeyArray(Result);
-	Result.Sort();
+	auto* GameInstance{ GetWorld() ? GetWorld()->GetGameInstance() : nullptr };
+	auto* SnapshotSubsystem{ GameInstance ? GameInstance->GetSubsystem<UTeamStateSnapshotSubsystem>() : nullptr };
 
-	return Result;
+	if (SnapshotSubsystem && SnapshotSubsystem->ConsumeTeamState(GetWorld(), RestoredTeamState))
+	{
+		GameModeOptionIndex.Reset();
+	}
 }
 
-TArray<int32> UTeamManagerSubsystem::GetEnemyTeamIDsFromActor(const AActor* TestActor) const
+void UTeamManagerSubsystem::CaptureTeamStateSnapshot(FTeamStateSnapshot& OutSnapshot) const
 {
-	TArray<int32> Result;
-	TeamMap.GenerateKeyArray(Result);
+	OutSnapshot.Reset();
 
-	auto AlliesTeamId{ FindTeamFromActor(TestActor) };
-	if (AlliesTeamId == INDEX_NONE)
+	TeamTable.ForEachTeam([&OutSnapshot](int32 TeamId, const FTeamTrackingInfo& TrackingInfo)
 	{
-		Result.Sort();
+		if (auto PublicTeamInfo{ TrackingInfo.PublicInfo })
+		{
+			auto& Team{ OutSnapshot.Teams.AddDefaulted_GetRef() };
+			Team.TeamId = TeamId;
 
-		return Result;
-	}
+			PublicTeamInfo->ForEachTeamTagStack([&Team](const FGameplayTag& Tag, int32 StackCount, int32 MaxStackCount)
+			{
+				auto& Stat{ Team.Stats.AddDefaulted_GetRef() };
+				Stat.Tag = Tag;
+				Stat.StackCount = StackCount;
+				Stat.MaxStackCount = MaxStackCount;
+			});
+		}
+	});
 
-	Result.RemoveSwap(AlliesTeamId);
+	const auto* World{ GetWorld() };
+	const auto* GameState{ World ? World->GetGameState() : nullptr };
 
-	Result.Sort();
+	if (GameState)
+	{
+		OutSnapshot.Members.Reserve(GameState->PlayerArray.Num());
 
-	return Result;
+		for (const auto& PlayerState : GameState->PlayerArray)
+		{
+			if (const auto* TeamMember{ FindTeamMemberComponent(PlayerState) })
+			{
+				auto& Member{ OutSnapshot.Members.AddDefaulted_GetRef() };
+				Member.MemberKey = FTeamStateSnapshot::MakeMemberKey(PlayerState);
+				Member.TeamId = TeamMember->GetTeamId();
+			}
+		}
+	}
 }
 
-
-// Game Mode Option
-
 bool UTeamManagerSubsystem::InitializeFromGameModeOption()
 {
 	auto bResult{ false };
 
 	UE_LOG(LogGameExt_Team, Log, TEXT("Initialize Team Stat From Game Mode Option"));
 
-	for (const auto& KVP : TeamMap)
+	TeamTable.ForEachTeam([&bResult](int32 TeamId, const FTeamTrackingInfo& TrackingInfo)
 	{
-		if (auto PublicTeamInfo{ KVP.Value.PublicInfo })
+		if (auto PublicTeamInfo{ TrackingInfo.PublicInfo })
 		{
 			bResult |= PublicTeamInfo->InitializeFromGameModeOption();
 		}
-	}
+	});
 
 	return bResult;
 }
@@ -352,13 +1471,13 @@ FString UTeamManagerSubsystem::ConstructGameModeOption() const
 
 	// Create Option from TeamInfo
 
-	for (const auto& KVP : TeamMap)
+	TeamTable.ForEachTeam([&Options](int32 TeamId, const FTeamTrackingInfo& TrackingInfo)
 	{
-		if (auto PublicTeamInfo{ KVP.Value.PublicInfo })
+		if (auto PublicTeamInfo{ TrackingInfo.PublicInfo })
 		{
 			Options += PublicTeamInfo->ConstructGameModeOption();
 		}
-	}
+	});
 
 	// Create Option from TeamAssign
 
@@ -4,13 +4,41 @@
 
 #include "Subsystems/WorldSubsystem.h"
 
-#include "TeamTrackingInfo.h"
+#include "TeamTrackingTable.h"
+#include "TeamMemberRegistry.h"
+#include "TeamAttitudeMatrix.h"
+#include "TeamSpatialHash.h"
+#include "TeamMemberChangeRecord.h"
+#include "TeamGameModeOptionIndex.h"
+#include "TeamStateSnapshot.h"
+#include "Replication/TeamIrisReplicationFilter.h"
 
 #include "GameplayTagContainer.h"
 
 #include "TeamManagerSubsystem.generated.h"
 
 class APlayerState;
+class APlayerController;
+class AController;
+class APawn;
+class AGameModeBase;
+class UTeamMemberComponent;
+class UTeamCreationData;
+class USceneComponent;
+class UMeshComponent;
+class UMaterialInterface;
+class UMaterialInstanceDynamic;
+class UTeamDisplayData;
+enum class EUpdateTransformFlags : int32;
+enum class ETeleportType : uint8;
+struct FOverlapResult;
+struct FHitResult;
+
+
+/**
+ * Delegate notified when the team of a player state in the player roster has changed
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FPlayerRosterChangedNativeDelegate, APlayerState*, FGenericTeamId);
 
 
 /**
@@ -21,9 +49,13 @@ enum class ETeamComparison : uint8
 {
 	OnSameTeam,			// Both actors are members of the same team
 
-	DifferentTeams,		// The actors are members of opposing teams
+	DifferentTeams,		// The actors are members of hostile teams
 
-	InvalidArgument		// One (or both) of the actors was invalid or not part of any team
+	InvalidArgument,	// One (or both) of the actors was invalid or not part of any team
+
+	AlliedTeams,		// The actors are members of different teams that are friendly to each other
+
+	NeutralTeams		// The actors are members of different teams that are neutral to each other
 };
 
 
@@ -42,22 +74,342 @@ public:
 public:
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
 
 
 protected:
 	UPROPERTY()
-	TMap<int32, FTeamTrackingInfo> TeamMap;
+	FTeamTrackingTable TeamTable;
+
+	//
+	// Delegate handed out when a display data notification is requested for an invalid team ID
+	// (cleared every time it is handed out, so bindings to it never accumulate)
+	//
+	FTeamDisplayDataChangedDelegate InvalidTeamDisplayDataChangedDelegate;
+
+	//
+	// Display data notification of each team ID, kept apart from TeamTable so that binding never adds a team
+	//
+	FTeamDisplayDataChangedDelegate TeamDisplayDataChangedDelegates[FTeamTrackingTable::MaxTeams];
+
+	//
+	// IDs of all teams in ascending order
+	//
+	TArray<int32> CachedTeamIds;
+
+	//
+	// IDs of teams hostile to each team in ascending order
+	//
+	TArray<int32> CachedEnemyTeamIds[FTeamTrackingTable::MaxTeams];
+
+	//
+	// IDs of other teams friendly to each team in ascending order
+	//
+	TArray<int32> CachedAllyTeamIds[FTeamTrackingTable::MaxTeams];
+
+protected:
+	/**
+	 * Rebuild the cached team lists after the teams or the attitudes between them have changed
+	 */
+	void RebuildTeamRelationshipCache();
 
 public:
 	void RegisterTeamInfo(ATeamInfoBase* TeamInfo);
 	void UnregisterTeamInfo(ATeamInfoBase* TeamInfo);
 
 	/**
-	 * Called when a team display data has been edited, causes all team color observers to update
+	 * Called when a team display data has been edited, causes team color observers of the teams using it to update
 	 */
 	void NotifyTeamDisplayDataModified(UTeamDisplayData* ModifiedData);
 
 
+	////////////////////////////////////////////////////
+	// Team Attitudes
+protected:
+	FTeamAttitudeMatrix AttitudeMatrix;
+
+public:
+	/**
+	 * Reset the attitudes between teams to the settings of the team creation data
+	 */
+	void ApplyTeamAttitudes(const UTeamCreationData* TeamCreationData);
+
+	/**
+	 * Sets the attitude of team A towards team B
+	 * 
+	 * Note:
+	 *	Attitudes are not replicated, so this should be called on every machine that needs them
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Teams")
+	void SetTeamAttitude(int32 TeamA, int32 TeamB, TEnumAsByte<ETeamAttitude::Type> Attitude, bool bMutual = true);
+
+	/**
+	 * Returns the attitude of team A towards team B
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams")
+	TEnumAsByte<ETeamAttitude::Type> GetTeamAttitude(int32 TeamA, int32 TeamB) const;
+
+	FORCEINLINE ETeamAttitude::Type GetTeamAttitude(FGenericTeamId TeamA, FGenericTeamId TeamB) const
+	{
+		return AttitudeMatrix.Get(TeamA, TeamB);
+	}
+
+	FORCEINLINE const FTeamAttitudeMatrix& GetTeamAttitudeMatrix() const { return AttitudeMatrix; }
+
+
+	////////////////////////////////////////////////////
+	// Team Members
+protected:
+	FTeamMemberRegistry MemberRegistry;
+
+public:
+	void RegisterTeamMember(UTeamMemberComponent* Member);
+	void UnregisterTeamMember(UTeamMemberComponent* Member);
+
+	/**
+	 * Called when the team of a registered team member has been changed
+	 */
+	void NotifyTeamMemberChanged(UTeamMemberComponent* Member, FGenericTeamId OldTeamId, FGenericTeamId NewTeamId);
+
+	/**
+	 * Called when the owner of a registered team member may have become active or inactive
+	 */
+	void NotifyTeamMemberActiveChanged(UTeamMemberComponent* Member);
+
+	/**
+	 * Broadcast all team changes queued during this frame immediately
+	 */
+	void FlushTeamMemberChanges();
+
+protected:
+	//
+	// Team changes queued during this frame
+	//
+	UPROPERTY(Transient)
+	TArray<FTeamMemberChangeRecord> PendingTeamMemberChanges;
+
+	//
+	// Actor to index of PendingTeamMemberChanges used to coalesce multiple changes of the same actor
+	//
+	TMap<TObjectKey<AActor>, int32> PendingTeamMemberChangeIndices;
+
+	bool bTeamMemberChangeFlushScheduled{ false };
+
+	void QueueTeamMemberChange(AActor* Actor, FGenericTeamId OldTeamId, FGenericTeamId NewTeamId);
+
+	/**
+	 * Queue team changes of the pawns that got or lost a player state with a team member
+	 * 
+	 * Tips:
+	 *	The team of a pawn usually comes from its player state, which may be set long after both have replicated
+	 */
+	UFUNCTION()
+	void HandlePlayerStatePawnSet(APlayerState* PlayerState, APawn* NewPawn, APawn* OldPawn);
+
+public:
+	//
+	// Notifies all team changes that occurred during a frame in a single batch
+	//
+	UPROPERTY(BlueprintAssignable)
+	FTeamMembersChangedDelegate OnTeamMembersChanged;
+
+	FTeamMembersChangedNativeDelegate OnTeamMembersChangedNative;
+
+protected:
+	//
+	// Team of each viewer (the owning controller of a team member player state) used for team-only net relevancy
+	// (keyed by object key so that a new controller allocated at the address of a destroyed one never inherits its team)
+	//
+	TMap<TObjectKey<AActor>, FGenericTeamId> ViewerTeamIds;
+
+	/**
+	 * Remove the cached teams of viewers that have been destroyed
+	 */
+	void RemoveStaleViewerTeams();
+
+	/**
+	 * Update the cached team and the team net condition group of the viewer that owns the member, if the member is owned by a player state
+	 */
+	void UpdateViewerTeam(const UTeamMemberComponent* Member, FGenericTeamId TeamId);
+
+public:
+	/**
+	 * Returns the team of the viewer (e.g., a player controller during net relevancy checks)
+	 * 
+	 * Tips:
+	 *	Resolved from a cache of the controllers of team member player states, falling back to the player state of the controller
+	 */
+	FGenericTeamId FindViewerTeam(const AActor* Viewer) const;
+
+protected:
+	void HandleGameModePostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer);
+	void HandleGameModeLogout(AGameModeBase* GameMode, AController* Exiting);
+	void HandleTeamMemberTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport, UTeamMemberComponent* Member);
+
+public:
+
+	/**
+	 * Returns the team member component to use for the actor
+	 * 
+	 * Tips:
+	 *	Resolved from the registry without scanning components of the actor.
+	 *	Use this instead of UTeamFunctionLibrary::GetTeamMemberComponentFromActor in hot paths
+	 */
+	UTeamMemberComponent* FindTeamMemberComponent(const AActor* Actor) const;
+
+	/**
+	 * Returns the team of the actor, or FGenericTeamId::NoTeam if it is not part of a team
+	 *
+	 * Tips:
+	 *	Resolved from the registry without scanning components of the actor.
+	 */
+	FGenericTeamId FindGenericTeamFromActor(const AActor* Actor) const;
+
+	/**
+	 * Returns the team member components registered to the team
+	 */
+	TConstArrayView<UTeamMemberComponent*> GetMembersOfTeam(int32 TeamId) const;
+
+	/**
+	 * Executes the function for each team member component registered to the team
+	 */
+	template<typename FuncType>
+	void ForEachMemberOfTeam(int32 TeamId, FuncType&& Func) const
+	{
+		for (auto* Member : GetMembersOfTeam(TeamId))
+		{
+			Func(Member);
+		}
+	}
+
+	/**
+	 * Returns the number of active players on the team
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams")
+	int32 GetActiveMemberCountOfTeam(int32 TeamId) const;
+
+
+	////////////////////////////////////////////////////
+	// Player Roster
+protected:
+	//
+	// Team of each player state
+	// 
+	// Tips:
+	//	Fed by the team member registry on the server and by the replicated roster of UTeamManagerComponent on clients,
+	//	so clients know the team of every player even when their player state or pawn is not relevant
+	//
+	TMap<TObjectKey<APlayerState>, FGenericTeamId> PlayerRosterTeamIds;
+
+	/**
+	 * Update the player roster from a team member owned by a player state on the server
+	 */
+	void UpdatePlayerRoster(const UTeamMemberComponent* Member, FGenericTeamId TeamId);
+
+public:
+	FPlayerRosterChangedNativeDelegate OnPlayerRosterChangedNative;
+
+	/**
+	 * Set the team of the player in the player roster, NoTeam removes the player
+	 */
+	void SetPlayerRosterTeam(APlayerState* PlayerState, FGenericTeamId TeamId);
+
+	/**
+	 * Returns the team of the player in the player roster or NoTeam if the player is not in it
+	 */
+	FGenericTeamId FindPlayerRosterTeam(const APlayerState* PlayerState) const;
+
+	/**
+	 * Returns the player states of the team in the player roster
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams")
+	void GetPlayersOfTeam(int32 TeamId, TArray<APlayerState*>& OutPlayerStates) const;
+
+	/**
+	 * Executes the function for each player state and its team in the player roster
+	 */
+	template<typename FuncType>
+	void ForEachPlayerInRoster(FuncType&& Func) const
+	{
+		for (const auto& KVP : PlayerRosterTeamIds)
+		{
+			if (auto* PlayerState{ KVP.Key.ResolveObjectPtr() })
+			{
+				Func(PlayerState, KVP.Value);
+			}
+		}
+	}
+
+
+	////////////////////////////////////////////////////
+	// Team Scoped Replication
+protected:
+	FTeamIrisReplicationFilter IrisReplicationFilter;
+
+	void HandleWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+public:
+	/**
+	 * Returns which connections the actor is replicated to, and the team it is scoped to
+	 * 
+	 * Tips:
+	 *	Team infos use ATeamInfoBase::GetTeamReplicationPolicy() and team members use UTeamMemberComponent::ReplicationPolicy
+	 */
+	ETeamReplicationPolicy GetActorReplicationPolicy(const AActor* Actor, FGenericTeamId& OutTeamId) const;
+
+	/**
+	 * Returns whether an actor of the team with the policy is replicated to a viewer of the viewer team
+	 */
+	bool IsReplicatedToViewerTeam(FGenericTeamId ViewerTeamId, FGenericTeamId ActorTeamId, ETeamReplicationPolicy Policy) const;
+
+
+	////////////////////////////////////////////////////
+	// Spatial Queries
+protected:
+	FTeamSpatialHash SpatialHash;
+
+public:
+	/**
+	 * Returns the nearest member of a team hostile to the specified team within the radius
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams|Spatial")
+	AActor* FindNearestEnemy(int32 TeamId, FVector Origin, float Radius) const;
+
+	/**
+	 * Gets the members of the specified team and its allied teams within the radius
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams|Spatial")
+	void GetAlliesInRadius(int32 TeamId, FVector Origin, float Radius, TArray<AActor*>& OutActors) const;
+
+	/**
+	 * Returns the number of members of teams hostile to the specified team inside the box
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams|Spatial")
+	int32 CountEnemiesInBox(int32 TeamId, FBox Box) const;
+
+	/**
+	 * Executes the function for each member of the teams within the radius
+	 */
+	template<typename FuncType>
+	void ForEachMemberInRadius(TConstArrayView<int32> TeamIds, const FVector& Origin, float Radius, FuncType&& Func) const
+	{
+		for (const auto& TeamId : TeamIds)
+		{
+			if (!FTeamTrackingTable::IsValidTeamId(TeamId))
+			{
+				continue;
+			}
+
+			SpatialHash.ForEachInRadius(static_cast<uint8>(TeamId), Origin, Radius, [&Func](const FTeamSpatialHash::FElement& Element)
+			{
+				Func(Element.Actor);
+			});
+		}
+	}
+
+	FORCEINLINE const FTeamSpatialHash& GetTeamSpatialHash() const { return SpatialHash; }
+
+
 public:
 	/**
 	 * Changes the team associated with this actor if possible
@@ -70,6 +422,9 @@ public:
 
 	/**
 	 * Returns true if the instigator can damage the target, taking into account the friendly fire settings
+	 * 
+	 * Tips:
+	 *	Damage is only allowed between teams that are hostile to each other
 	 */
 	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams")
 	bool CanCauseDamage(const AActor* Instigator, const AActor* Target, bool bAllowDamageToSelf = true) const;
@@ -80,7 +435,30 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams", meta = (ExpandEnumAsExecs = ReturnValue))
 	ETeamComparison CompareTeams(const AActor* A, const AActor* B, int32& TeamIdA, int32& TeamIdB) const;
 	ETeamComparison CompareTeams(const AActor* A, const AActor* B) const;
-	
+
+	/**
+	 * Returns for each target whether the instigator can damage it, as a bitmask in the same order as the targets
+	 * 
+	 * Tips:
+	 *	The instigator's team is resolved once and the targets are compared against a precomputed row of the attitude matrix,
+	 *	which is much faster than calling CanCauseDamage per target for area-of-effect hits
+	 */
+	void CanCauseDamageBatch(const AActor* Instigator, TArrayView<const AActor* const> Targets, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf = true) const;
+	void CanCauseDamageBatch(const AActor* Instigator, TArrayView<const FOverlapResult> Overlaps, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf = true) const;
+	void CanCauseDamageBatch(const AActor* Instigator, TArrayView<const FHitResult> Hits, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf = true) const;
+
+	/**
+	 * Compare the team of actor A with the teams of each target, in the same order as the targets
+	 */
+	void CompareTeamsBatch(const AActor* A, TArrayView<const AActor* const> Targets, TArray<ETeamComparison>& OutComparisons) const;
+
+protected:
+	template<typename GetActorFuncType>
+	void CanCauseDamageBatchInternal(const AActor* Instigator, int32 NumTargets, GetActorFuncType&& GetActorFunc, TBitArray<>& OutCanDamage, bool bAllowDamageToSelf) const;
+
+	static ETeamComparison AttitudeToComparison(ETeamAttitude::Type Attitude);
+
+public:
 	/**
 	 * Adds a specified number of stacks to the tag (does nothing if StackCount is below 1)
 	 */
@@ -165,10 +543,145 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams")
 	TArray<int32> GetEnemyTeamIDsFromActor(const AActor* TestActor) const;
 
+	/**
+	 * Gets the list of other teams allied with the actor's team
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams")
+	TArray<int32> GetAllyTeamIDsFromActor(const AActor* TestActor) const;
+
+	/**
+	 * Gets the list of teams in ascending order without allocation
+	 */
+	TConstArrayView<int32> GetTeamIDsView() const { return CachedTeamIds; }
+
+	/**
+	 * Gets the list of teams hostile to the team in ascending order without allocation
+	 * 
+	 * Tips:
+	 *	All teams are returned for INDEX_NONE (not part of any team)
+	 */
+	TConstArrayView<int32> GetEnemyTeamIDs(int32 TeamId) const;
+
+	/**
+	 * Gets the list of other teams friendly to the team in ascending order without allocation
+	 */
+	TConstArrayView<int32> GetAllyTeamIDs(int32 TeamId) const;
+
+
+	////////////////////////////////////////////////////
+	// Team Material Pool
+protected:
+	//
+	// Seconds between sweeps of pooled team materials whose users have been destroyed or changed their material
+	//
+	static constexpr float TeamMaterialPoolSweepInterval{ 10.0f };
+
+	using FTeamMaterialPoolKey = TPair<TObjectKey<UMaterialInterface>, TObjectKey<UTeamDisplayData>>;
+	using FTeamMaterialPoolUser = TPair<TWeakObjectPtr<const UMeshComponent>, int32>;
+
+	/**
+	 * Dynamic material shared by all mesh component slots using the same parent material and display data
+	 */
+	struct FTeamMaterialPoolEntry
+	{
+	public:
+		UMaterialInstanceDynamic* Material{ nullptr };
+
+		TWeakObjectPtr<const UTeamDisplayData> DisplayData;
+
+		//
+		// Mesh component and material index of each slot using the material (the reference count)
+		//
+		TSet<FTeamMaterialPoolUser> Users;
+	};
+
+	TMap<FTeamMaterialPoolKey, FTeamMaterialPoolEntry> TeamMaterialPool;
+
+	//
+	// Pooled material to its key in TeamMaterialPool
+	//
+	TMap<TObjectKey<UMaterialInstanceDynamic>, FTeamMaterialPoolKey> TeamMaterialPoolKeys;
+
+	//
+	// Keeps pooled materials alive while they are in the pool
+	//
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UMaterialInstanceDynamic>> PooledTeamMaterials;
+
+	FTimerHandle TeamMaterialPoolSweepTimerHandle;
+
+protected:
+	void RemoveTeamMaterialPoolEntry(FTeamMaterialPoolKey Key);
+
+public:
+	/**
+	 * Remove the slot from the users of the pooled material and release the material when it has no users left
+	 */
+	void ReleaseTeamMaterial(UMaterialInstanceDynamic* Material, const UMeshComponent* MeshComponent, int32 MaterialIndex);
+
+	/**
+	 * Set the slot of the mesh component to the material shared for the parent material and display data
+	 * 
+	 * Tips:
+	 *	The material is created with the parameters of the display data on first use and released when no slot uses it,
+	 *	so the number of materials scales with teams x parent materials instead of components x slots
+	 */
+	UMaterialInstanceDynamic* ApplyTeamMaterial(UMeshComponent* MeshComponent, int32 MaterialIndex, UMaterialInterface* ParentMaterial, const UTeamDisplayData* DisplayData);
+
+	/**
+	 * Release all pooled materials used by the mesh component
+	 * 
+	 * Tips:
+	 *	Optional, slots of destroyed components or slots that changed their material are released by a periodic sweep
+	 */
+	void ReleaseTeamMaterials(UMeshComponent* MeshComponent);
+
+	/**
+	 * Release materials whose users have all been destroyed or changed their material
+	 */
+	void SweepTeamMaterialPool();
+
+	/**
+	 * Apply the current parameters of the display data to its pooled materials
+	 */
+	void RefreshTeamMaterials(const UTeamDisplayData* DisplayData);
+
+	/**
+	 * Returns whether the material is shared by the team material pool
+	 */
+	bool IsPooledTeamMaterial(const UMaterialInterface* Material) const;
+
+	int32 GetNumPooledTeamMaterials() const { return TeamMaterialPool.Num(); }
+
 
 	////////////////////////////////////////////////////
 	// Game Mode Option
+protected:
+	FTeamGameModeOptionIndex GameModeOptionIndex;
+
+	//
+	// Team state restored from the game instance after map travel
+	//
+	FTeamStateSnapshot RestoredTeamState;
+
+	bool bTeamStateRestoreChecked{ false };
+
+	/**
+	 * Take the team state captured for this world from the game instance, once
+	 */
+	void RestoreTeamState();
+
 public:
+	/**
+	 * Returns the team related options of the game mode, parsed once per options string
+	 */
+	const FTeamGameModeOptionIndex& GetGameModeOptionIndex(const AGameModeBase* GameMode);
+
+	/**
+	 * Write the current team state into the snapshot
+	 */
+	void CaptureTeamStateSnapshot(FTeamStateSnapshot& OutSnapshot) const;
+
 	UFUNCTION(BlueprintAuthorityOnly, BlueprintCallable, Category = "Teams")
 	virtual bool InitializeFromGameModeOption();
 
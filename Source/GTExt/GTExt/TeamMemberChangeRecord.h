@@ -0,0 +1,41 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "TeamMemberChangeRecord.generated.h"
+
+class AActor;
+
+
+/**
+ * Record of an actor whose team has been changed
+ */
+USTRUCT(BlueprintType)
+struct FTeamMemberChangeRecord
+{
+	GENERATED_BODY()
+public:
+	FTeamMemberChangeRecord() {}
+
+	FTeamMemberChangeRecord(AActor* InActor, int32 InOldTeamId, int32 InNewTeamId)
+		: Actor(InActor), OldTeamId(InOldTeamId), NewTeamId(InNewTeamId)
+	{}
+
+public:
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<AActor> Actor{ nullptr };
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 OldTeamId{ INDEX_NONE };
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NewTeamId{ INDEX_NONE };
+
+};
+
+
+/**
+ * Delegate notified of all team changes that occurred during a frame
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FTeamMembersChangedDelegate, const TArray<FTeamMemberChangeRecord>&, Records);
+DECLARE_MULTICAST_DELEGATE_OneParam(FTeamMembersChangedNativeDelegate, TConstArrayView<FTeamMemberChangeRecord>);
@@ -2,7 +2,15 @@
 
 #include "TeamMemberComponent.h"
 
+#include "TeamManagerSubsystem.h"
+#include "TeamFunctionLibrary.h"
+#include "Replication/TeamOnlyReplicatedObject.h"
+#include "Replication/TeamNetConditionGroups.h"
+#include "GTExtLogs.h"
+
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "Net/Core/Misc/NetConditionGroupManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(TeamMemberComponent)
 
@@ -22,19 +30,169 @@ void UTeamMemberComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>&
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(ThisClass, MyTeamID);
+	// Team changes are rare, so the team ID is only compared when it is marked dirty
+
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, MyTeamID, Params);
+}
+
+
+void UTeamMemberComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TMS->RegisterTeamMember(this);
+	}
+}
+
+void UTeamMemberComponent::OnUnregister()
+{
+	for (const auto& SubObject : TeamOnlySubObjects)
+	{
+		if (SubObject)
+		{
+			UE::Net::FNetConditionGroupManager::UnregisterSubObjectFromGroup(SubObject, FTeamNetConditionGroups::GetTeamGroupName(MyTeamID));
+		}
+	}
+
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TMS->UnregisterTeamMember(this);
+	}
+
+	Super::OnUnregister();
 }
 
 
 void UTeamMemberComponent::OnRep_MyTeamID(FGenericTeamId OldTeamID)
 {
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TMS->NotifyTeamMemberChanged(this, OldTeamID, MyTeamID);
+	}
+
+	OnTeamChanged.Broadcast(GetOwner(), UTeamFunctionLibrary::GenericTeamIdToInteger(OldTeamID), UTeamFunctionLibrary::GenericTeamIdToInteger(MyTeamID));
 }
 
 void UTeamMemberComponent::SetGenericTeamId(const FGenericTeamId& NewTeamID)
 {
 	if (GetOwner()->HasAuthority())
 	{
+		const auto OldTeamID{ MyTeamID };
 		MyTeamID = NewTeamID;
+
+		if (OldTeamID != NewTeamID)
+		{
+			MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, MyTeamID, this);
+
+			if (bFlushOwnerDormancyOnTeamChange)
+			{
+				GetOwner()->FlushNetDormancy();
+			}
+
+			UpdateTeamOnlySubObjectGroups(OldTeamID, NewTeamID);
+
+			if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+			{
+				TMS->NotifyTeamMemberChanged(this, OldTeamID, NewTeamID);
+			}
+
+			OnTeamChanged.Broadcast(GetOwner(), UTeamFunctionLibrary::GenericTeamIdToInteger(OldTeamID), UTeamFunctionLibrary::GenericTeamIdToInteger(NewTeamID));
+		}
+	}
+}
+
+ETeamAttitude::Type UTeamMemberComponent::GetTeamAttitudeTowards(const AActor& Other) const
+{
+	if (const auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		const auto OtherTeamID{ TMS->FindGenericTeamFromActor(&Other) };
+
+		// Actors that are not team members may still be team agents on their own
+
+		if (OtherTeamID != FGenericTeamId::NoTeam)
+		{
+			return TMS->GetTeamAttitude(MyTeamID, OtherTeamID);
+		}
+	}
+
+	return IGenericTeamAgentInterface::GetTeamAttitudeTowards(Other);
+}
+
+void UTeamMemberComponent::RefreshActiveState()
+{
+	if (auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(GetWorld()) })
+	{
+		TMS->NotifyTeamMemberActiveChanged(this);
+	}
+}
+
+
+void UTeamMemberComponent::UpdateTeamOnlySubObjectGroups(FGenericTeamId OldTeamID, FGenericTeamId NewTeamID)
+{
+	const auto OldGroupName{ FTeamNetConditionGroups::GetTeamGroupName(OldTeamID) };
+	const auto NewGroupName{ FTeamNetConditionGroups::GetTeamGroupName(NewTeamID) };
+
+	for (const auto& SubObject : TeamOnlySubObjects)
+	{
+		if (!SubObject)
+		{
+			continue;
+		}
+
+		if (!OldGroupName.IsNone())
+		{
+			UE::Net::FNetConditionGroupManager::UnregisterSubObjectFromGroup(SubObject, OldGroupName);
+		}
+
+		// Subobjects without a team are in no group and therefore not replicated to anyone
+
+		if (!NewGroupName.IsNone())
+		{
+			UE::Net::FNetConditionGroupManager::RegisterSubObjectInGroup(SubObject, NewGroupName);
+		}
+	}
+}
+
+void UTeamMemberComponent::AddTeamOnlySubObject(UTeamOnlyReplicatedObject* SubObject)
+{
+	if (!SubObject || !GetOwner()->HasAuthority() || TeamOnlySubObjects.Contains(SubObject))
+	{
+		return;
+	}
+
+	UE_CLOG(!GetOwner()->IsUsingRegisteredSubObjectList(), LogGameExt_Team, Warning,
+		TEXT("AddTeamOnlySubObject: Owner(%s) does not replicate using the registered subobject list, so %s will not be replicated"),
+		*GetNameSafe(GetOwner()), *GetNameSafe(SubObject));
+
+	TeamOnlySubObjects.Add(SubObject);
+
+	const auto GroupName{ FTeamNetConditionGroups::GetTeamGroupName(MyTeamID) };
+	if (!GroupName.IsNone())
+	{
+		UE::Net::FNetConditionGroupManager::RegisterSubObjectInGroup(SubObject, GroupName);
+	}
+
+	AddReplicatedSubObject(SubObject, COND_NetGroup);
+}
+
+void UTeamMemberComponent::RemoveTeamOnlySubObject(UTeamOnlyReplicatedObject* SubObject)
+{
+	if (!SubObject || (TeamOnlySubObjects.Remove(SubObject) <= 0))
+	{
+		return;
+	}
+
+	RemoveReplicatedSubObject(SubObject);
+
+	const auto GroupName{ FTeamNetConditionGroups::GetTeamGroupName(MyTeamID) };
+	if (!GroupName.IsNone())
+	{
+		UE::Net::FNetConditionGroupManager::UnregisterSubObjectFromGroup(SubObject, GroupName);
 	}
 }
 
@@ -5,8 +5,12 @@
 #include "Component/GFCActorComponent.h"
 #include "GenericTeamAgentInterface.h"
 
+#include "Replication/TeamReplicationPolicy.h"
+
 #include "TeamMemberComponent.generated.h"
 
+class UTeamOnlyReplicatedObject;
+
 
 /**
  * Delegate to be notified that the team ID you belong to has changed
@@ -23,6 +27,10 @@ class GTEXT_API UTeamMemberComponent
 	, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
+
+	friend class FTeamMemberRegistry;
+	friend class UTeamManagerSubsystem;
+
 public:
 	UTeamMemberComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
@@ -33,10 +41,107 @@ public:
 	//
 	static const FName NAME_ActorFeatureName;
 
+protected:
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+
 public:
 	virtual FName GetFeatureName() const override { return NAME_ActorFeatureName; }
 
 
+protected:
+	//
+	// Index of this component in the team member registry of UTeamManagerSubsystem
+	//
+	int32 RegistryIndex{ INDEX_NONE };
+
+	//
+	// Index of this component in the roster of its team
+	//
+	int32 RosterIndex{ INDEX_NONE };
+
+	//
+	// Whether this component is counted as an active player of its team
+	//
+	bool bActiveTeamMember{ false };
+
+	//
+	// ID of the owner in the team spatial hash of UTeamManagerSubsystem
+	//
+	int32 SpatialIndex{ INDEX_NONE };
+
+	//
+	// Root component of the owner whose movement is tracked by the team spatial hash
+	//
+	TWeakObjectPtr<USceneComponent> TrackedRootComponent;
+
+	FDelegateHandle TransformUpdatedHandle;
+
+public:
+	//
+	// Whether the location of the owner is tracked for spatial team queries
+	// 
+	// Tips:
+	//	Only owners with a root component can be tracked (e.g., pawns but not player states)
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Team")
+	bool bTrackLocation{ true };
+
+	//
+	// Whether the dormancy of the owner is flushed when the team changes
+	// 
+	// Tips:
+	//	MyTeamID is push based, so owners that only replicate team state can be made dormant (e.g., DORM_DormantAll)
+	//	and will stay dormant until the team actually changes
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Team")
+	bool bFlushOwnerDormancyOnTeamChange{ true };
+
+	//
+	// Which connections the owner is replicated to when team scoped replication is used
+	// 
+	// Tips:
+	//	Only applies with UReplicationGraphNode_TeamScoped or with Iris replication
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Team")
+	ETeamReplicationPolicy ReplicationPolicy{ ETeamReplicationPolicy::PublicToAll };
+
+
+protected:
+	//
+	// Subobjects replicated only to the connections of the team of the owner
+	//
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UTeamOnlyReplicatedObject>> TeamOnlySubObjects;
+
+	/**
+	 * Move team only subobjects to the net condition group of the new team
+	 */
+	void UpdateTeamOnlySubObjectGroups(FGenericTeamId OldTeamID, FGenericTeamId NewTeamID);
+
+public:
+	/**
+	 * Replicate the subobject only to the connections whose player state is on the same team as the owner
+	 * 
+	 * Tips:
+	 *	Membership is resolved per connection by net condition groups (COND_NetGroup),
+	 *	so the cost per replicated property does not depend on the number of teams or members
+	 * 
+	 * Note:
+	 *	Only works on the server and the owner must set bReplicateUsingRegisteredSubObjectList
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Team")
+	void AddTeamOnlySubObject(UTeamOnlyReplicatedObject* SubObject);
+
+	/**
+	 * Stop replicating the subobject added with AddTeamOnlySubObject()
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Team")
+	void RemoveTeamOnlySubObject(UTeamOnlyReplicatedObject* SubObject);
+
+	const TArray<TObjectPtr<UTeamOnlyReplicatedObject>>& GetTeamOnlySubObjects() const { return TeamOnlySubObjects; }
+
+
 public:
 	UPROPERTY(BlueprintAssignable)
 	FTeamIdChangedDelegate OnTeamChanged;
@@ -52,10 +157,26 @@ protected:
 public:
 	virtual void SetGenericTeamId(const FGenericTeamId& NewTeamID) override;
 	virtual FGenericTeamId GetGenericTeamId() const override { return MyTeamID; }
+	virtual ETeamAttitude::Type GetTeamAttitudeTowards(const AActor& Other) const override;
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Team")
 	int32 GetTeamId() const { return static_cast<int32>(MyTeamID.GetId()); }
 
+	/**
+	 * Returns whether the owner is counted as an active player of its team
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Team")
+	bool IsActiveTeamMember() const { return bActiveTeamMember; }
+
+	/**
+	 * Re-evaluate whether the owner counts as an active player of its team
+	 * 
+	 * Tips:
+	 *	Logins and logouts are handled automatically, call this when the owning player state becomes inactive or is reactivated in another way
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Team")
+	void RefreshActiveState();
+
 public:
 	UFUNCTION(BlueprintPure, Category = "Component")
 	static UTeamMemberComponent* FindTeamMemberComponent(const AActor* Actor);
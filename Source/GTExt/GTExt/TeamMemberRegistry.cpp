@@ -0,0 +1,218 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamMemberRegistry.h"
+
+#include "TeamMemberComponent.h"
+#include "TeamMemberComponentInterface.h"
+#include "TeamFunctionLibrary.h"
+
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+
+
+void FTeamMemberRegistry::Add(UTeamMemberComponent* Member)
+{
+	check(Member);
+
+	if (Member->RegistryIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	// Actors that expose their team member component through the interface may redirect to another component at any time,
+	// so they are not indexed and are resolved through the interface instead
+
+	const auto* Owner{ Member->GetOwner() };
+	const auto* IndexedActor{ (Owner && !Owner->Implements<UTeamMemberComponentInterface>()) ? Owner : nullptr };
+
+	// Only the first component of an actor is indexed, so removing another one never drops its mapping
+
+	if (IndexedActor && !ensureMsgf(!ActorToMemberIndex.Contains(IndexedActor), TEXT("%s has more than one team member component"), *GetNameSafe(IndexedActor)))
+	{
+		IndexedActor = nullptr;
+	}
+
+	const auto NewIndex{ Members.Add(Member) };
+	MemberTeamIds.Add(Member->GetGenericTeamId());
+	MemberActors.Add(IndexedActor);
+
+	if (IndexedActor)
+	{
+		ActorToMemberIndex.Add(IndexedActor, NewIndex);
+	}
+
+	Member->RegistryIndex = NewIndex;
+
+	AddToRoster(Member, Member->GetGenericTeamId());
+}
+
+void FTeamMemberRegistry::Remove(UTeamMemberComponent* Member)
+{
+	check(Member);
+
+	const auto Index{ Member->RegistryIndex };
+	if (!Members.IsValidIndex(Index) || (Members[Index] != Member))
+	{
+		return;
+	}
+
+	RemoveFromRoster(Member, MemberTeamIds[Index]);
+
+	if (const auto* IndexedActor{ MemberActors[Index] })
+	{
+		if (const auto* MappedIndex{ ActorToMemberIndex.Find(IndexedActor) }; MappedIndex && (*MappedIndex == Index))
+		{
+			ActorToMemberIndex.Remove(IndexedActor);
+		}
+	}
+
+	// Move the last element into the removed slot and fix up its index
+
+	const auto LastIndex{ Members.Num() - 1 };
+	if (Index != LastIndex)
+	{
+		auto* MovedMember{ Members[LastIndex] };
+		MovedMember->RegistryIndex = Index;
+
+		if (const auto* MovedActor{ MemberActors[LastIndex] })
+		{
+			if (auto* MappedIndex{ ActorToMemberIndex.Find(MovedActor) }; MappedIndex && (*MappedIndex == LastIndex))
+			{
+				*MappedIndex = Index;
+			}
+		}
+	}
+
+	Members.RemoveAtSwap(Index, 1, /*bAllowShrinking*/ false);
+	MemberTeamIds.RemoveAtSwap(Index, 1, /*bAllowShrinking*/ false);
+	MemberActors.RemoveAtSwap(Index, 1, /*bAllowShrinking*/ false);
+
+	Member->RegistryIndex = INDEX_NONE;
+}
+
+void FTeamMemberRegistry::UpdateTeam(UTeamMemberComponent* Member, FGenericTeamId NewTeamId)
+{
+	check(Member);
+
+	const auto Index{ Member->RegistryIndex };
+	if (Members.IsValidIndex(Index) && (Members[Index] == Member))
+	{
+		RemoveFromRoster(Member, MemberTeamIds[Index]);
+
+		MemberTeamIds[Index] = NewTeamId;
+
+		AddToRoster(Member, NewTeamId);
+	}
+}
+
+void FTeamMemberRegistry::RefreshActive(UTeamMemberComponent* Member)
+{
+	check(Member);
+
+	const auto Index{ Member->RegistryIndex };
+	if (!Members.IsValidIndex(Index) || (Members[Index] != Member))
+	{
+		return;
+	}
+
+	const auto bNewActive{ IsActiveMember(Member) };
+	if (Member->bActiveTeamMember != bNewActive)
+	{
+		Member->bActiveTeamMember = bNewActive;
+
+		const auto TeamId{ MemberTeamIds[Index] };
+		if (TeamId != FGenericTeamId::NoTeam)
+		{
+			ActiveMemberCounts[TeamId.GetId()] += bNewActive ? 1 : -1;
+		}
+	}
+}
+
+void FTeamMemberRegistry::Reset()
+{
+	for (auto* Member : Members)
+	{
+		Member->RegistryIndex = INDEX_NONE;
+		Member->RosterIndex = INDEX_NONE;
+		Member->bActiveTeamMember = false;
+	}
+
+	Members.Reset();
+	MemberTeamIds.Reset();
+	MemberActors.Reset();
+	ActorToMemberIndex.Reset();
+
+	for (auto& Roster : TeamRosters)
+	{
+		Roster.Reset();
+	}
+
+	FMemory::Memzero(ActiveMemberCounts);
+}
+
+
+void FTeamMemberRegistry::AddToRoster(UTeamMemberComponent* Member, FGenericTeamId TeamId)
+{
+	Member->bActiveTeamMember = IsActiveMember(Member);
+
+	if (TeamId == FGenericTeamId::NoTeam)
+	{
+		return;
+	}
+
+	auto& Roster{ TeamRosters[TeamId.GetId()] };
+	Member->RosterIndex = Roster.Add(Member);
+
+	if (Member->bActiveTeamMember)
+	{
+		ActiveMemberCounts[TeamId.GetId()]++;
+	}
+}
+
+void FTeamMemberRegistry::RemoveFromRoster(UTeamMemberComponent* Member, FGenericTeamId TeamId)
+{
+	if ((TeamId == FGenericTeamId::NoTeam) || (Member->RosterIndex == INDEX_NONE))
+	{
+		return;
+	}
+
+	auto& Roster{ TeamRosters[TeamId.GetId()] };
+	const auto Index{ Member->RosterIndex };
+	check(Roster.IsValidIndex(Index) && (Roster[Index] == Member));
+
+	// Move the last element into the removed slot and fix up its index
+
+	Roster.Last()->RosterIndex = Index;
+	Roster.RemoveAtSwap(Index, 1, /*bAllowShrinking*/ false);
+
+	Member->RosterIndex = INDEX_NONE;
+
+	if (Member->bActiveTeamMember)
+	{
+		ActiveMemberCounts[TeamId.GetId()]--;
+	}
+}
+
+bool FTeamMemberRegistry::IsActiveMember(const UTeamMemberComponent* Member)
+{
+	const auto* Owner{ Member->GetOwner() };
+	const APlayerState* PlayerState{ nullptr };
+
+	if (const auto* Controller{ Cast<AController>(Owner) })
+	{
+		PlayerState = Controller->PlayerState;
+	}
+	else if (const auto* Pawn{ Cast<APawn>(Owner) })
+	{
+		PlayerState = Pawn->GetPlayerState();
+	}
+	else
+	{
+		PlayerState = Cast<APlayerState>(Owner);
+	}
+
+	// Same as the component found for the player state, which may be redirected to another actor
+
+	return PlayerState && !PlayerState->IsInactive() && (UTeamFunctionLibrary::GetTeamMemberComponentFromActor(PlayerState) == Member);
+}
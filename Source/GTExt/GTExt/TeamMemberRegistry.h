@@ -0,0 +1,139 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GenericTeamAgentInterface.h"
+
+class UTeamMemberComponent;
+class AActor;
+
+
+/**
+ * Registry of all team member components that exist in the world
+ *
+ * Tips:
+ *	Components are stored densely and indexed by their owning actor, so team lookups from an actor
+ *	are a single hash probe instead of an interface cast and a component scan.
+ *	Each team also keeps a live roster and the number of active players on it, so team assignment
+ *	does not need to recount every player state
+ */
+class GTEXT_API FTeamMemberRegistry
+{
+public:
+	FTeamMemberRegistry() {}
+
+	//
+	// Number of team IDs that can be represented by FGenericTeamId
+	//
+	static constexpr int32 MaxTeams{ 256 };
+
+protected:
+	//
+	// Registered components in dense order
+	//
+	TArray<UTeamMemberComponent*> Members;
+
+	//
+	// Team ID of each registered component (same order as Members)
+	//
+	TArray<FGenericTeamId> MemberTeamIds;
+
+	//
+	// Actor indexed for each registered component (same order as Members)
+	//
+	TArray<const AActor*> MemberActors;
+
+	//
+	// Owning actor to index of Members
+	//
+	TMap<const AActor*, int32> ActorToMemberIndex;
+
+	//
+	// Registered components of each team
+	//
+	TArray<UTeamMemberComponent*> TeamRosters[MaxTeams];
+
+	//
+	// Number of active player states on each team
+	//
+	int32 ActiveMemberCounts[MaxTeams]{ 0 };
+
+protected:
+	void AddToRoster(UTeamMemberComponent* Member, FGenericTeamId TeamId);
+	void RemoveFromRoster(UTeamMemberComponent* Member, FGenericTeamId TeamId);
+
+	/**
+	 * Returns whether the component counts as an active player of its team
+	 * 
+	 * Tips:
+	 *	Only the component a player state that is not inactive resolves to is counted,
+	 *	which may live on its controller or pawn when the player state redirects through ITeamMemberComponentInterface
+	 */
+	static bool IsActiveMember(const UTeamMemberComponent* Member);
+
+public:
+	/**
+	 * Add component to registry
+	 */
+	void Add(UTeamMemberComponent* Member);
+
+	/**
+	 * Remove component from registry
+	 */
+	void Remove(UTeamMemberComponent* Member);
+
+	/**
+	 * Update the team ID cached for the component
+	 */
+	void UpdateTeam(UTeamMemberComponent* Member, FGenericTeamId NewTeamId);
+
+	/**
+	 * Re-evaluate whether the component counts as an active player of its team
+	 */
+	void RefreshActive(UTeamMemberComponent* Member);
+
+	/**
+	 * Remove all registered components
+	 */
+	void Reset();
+
+public:
+	/**
+	 * Returns the component registered for the actor or nullptr if not registered
+	 */
+	FORCEINLINE UTeamMemberComponent* FindByActor(const AActor* Actor) const
+	{
+		const auto* Index{ ActorToMemberIndex.Find(Actor) };
+		return Index ? Members[*Index] : nullptr;
+	}
+
+	/**
+	 * Returns the index of the actor in the registry or INDEX_NONE if not registered
+	 */
+	FORCEINLINE int32 FindIndexByActor(const AActor* Actor) const
+	{
+		const auto* Index{ ActorToMemberIndex.Find(Actor) };
+		return Index ? *Index : INDEX_NONE;
+	}
+
+	FORCEINLINE UTeamMemberComponent* GetMember(int32 Index) const { return Members[Index]; }
+	FORCEINLINE FGenericTeamId GetMemberTeamId(int32 Index) const { return MemberTeamIds[Index]; }
+	FORCEINLINE int32 Num() const { return Members.Num(); }
+
+	/**
+	 * Returns the registered components of the team
+	 */
+	FORCEINLINE TConstArrayView<UTeamMemberComponent*> GetTeamRoster(FGenericTeamId TeamId) const
+	{
+		return (TeamId != FGenericTeamId::NoTeam) ? TConstArrayView<UTeamMemberComponent*>(TeamRosters[TeamId.GetId()]) : TConstArrayView<UTeamMemberComponent*>();
+	}
+
+	/**
+	 * Returns the number of active player states on the team
+	 */
+	FORCEINLINE int32 GetActiveMemberCount(FGenericTeamId TeamId) const
+	{
+		return (TeamId != FGenericTeamId::NoTeam) ? ActiveMemberCounts[TeamId.GetId()] : 0;
+	}
+
+};
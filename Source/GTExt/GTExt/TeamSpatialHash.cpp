@@ -0,0 +1,163 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamSpatialHash.h"
+
+#include "TeamTrackingTable.h"
+
+
+FTeamSpatialHash::FTeamSpatialHash(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.0f))
+	, InvCellSize(1.0f / FMath::Max(InCellSize, 1.0f))
+{
+}
+
+
+void FTeamSpatialHash::LinkToCell(int32 ElementId)
+{
+	auto& Element{ Elements[ElementId] };
+	auto& CellElements{ TeamCells[Element.TeamId].FindOrAdd(Element.Cell) };
+
+	Element.IndexInCell = CellElements.Add(ElementId);
+}
+
+void FTeamSpatialHash::UnlinkFromCell(int32 ElementId)
+{
+	auto& Element{ Elements[ElementId] };
+	auto& Cells{ TeamCells[Element.TeamId] };
+
+	auto* CellElements{ Cells.Find(Element.Cell) };
+	check(CellElements && CellElements->IsValidIndex(Element.IndexInCell));
+
+	// Move the last element into the removed slot and fix up its index
+
+	Elements[CellElements->Last()].IndexInCell = Element.IndexInCell;
+	CellElements->RemoveAtSwap(Element.IndexInCell, 1, /*bAllowShrinking*/ false);
+
+	if (CellElements->IsEmpty())
+	{
+		Cells.Remove(Element.Cell);
+	}
+
+	Element.IndexInCell = INDEX_NONE;
+}
+
+
+int32 FTeamSpatialHash::Add(AActor* Actor, FGenericTeamId TeamId, const FVector& Location)
+{
+	FElement NewElement;
+	NewElement.Actor = Actor;
+	NewElement.Location = Location;
+	NewElement.Cell = ToCell(Location);
+	NewElement.TeamId = TeamId.GetId();
+
+	const auto ElementId{ Elements.Add(NewElement) };
+	LinkToCell(ElementId);
+
+	return ElementId;
+}
+
+void FTeamSpatialHash::Remove(int32 ElementId)
+{
+	if (Elements.IsValidIndex(ElementId))
+	{
+		UnlinkFromCell(ElementId);
+		Elements.RemoveAt(ElementId);
+	}
+}
+
+void FTeamSpatialHash::Move(int32 ElementId, const FVector& NewLocation)
+{
+	if (!Elements.IsValidIndex(ElementId))
+	{
+		return;
+	}
+
+	auto& Element{ Elements[ElementId] };
+	Element.Location = NewLocation;
+
+	// Only relink when the element crosses into another cell
+
+	const auto NewCell{ ToCell(NewLocation) };
+	if (Element.Cell != NewCell)
+	{
+		UnlinkFromCell(ElementId);
+		Element.Cell = NewCell;
+		LinkToCell(ElementId);
+	}
+}
+
+void FTeamSpatialHash::SetTeam(int32 ElementId, FGenericTeamId NewTeamId)
+{
+	if (!Elements.IsValidIndex(ElementId))
+	{
+		return;
+	}
+
+	auto& Element{ Elements[ElementId] };
+	if (Element.TeamId != NewTeamId.GetId())
+	{
+		UnlinkFromCell(ElementId);
+		Element.TeamId = NewTeamId.GetId();
+		LinkToCell(ElementId);
+	}
+}
+
+void FTeamSpatialHash::Reset()
+{
+	Elements.Reset();
+
+	for (auto& Cells : TeamCells)
+	{
+		Cells.Reset();
+	}
+}
+
+
+AActor* FTeamSpatialHash::FindNearest(TConstArrayView<int32> TeamIds, const FVector& Origin, float Radius, const AActor* IgnoreActor) const
+{
+	AActor* Nearest{ nullptr };
+	auto NearestDistanceSquared{ FMath::Square(Radius) };
+
+	const FBox Box(Origin - FVector(Radius), Origin + FVector(Radius));
+
+	for (const auto& TeamId : TeamIds)
+	{
+		if (!FTeamTrackingTable::IsValidTeamId(TeamId))
+		{
+			continue;
+		}
+
+		ForEachInBox(static_cast<uint8>(TeamId), Box, [&](const FElement& Element)
+		{
+			const auto DistanceSquared{ FVector::DistSquared(Element.Location, Origin) };
+
+			if ((DistanceSquared <= NearestDistanceSquared) && (Element.Actor != IgnoreActor))
+			{
+				Nearest = Element.Actor;
+				NearestDistanceSquared = DistanceSquared;
+			}
+		});
+	}
+
+	return Nearest;
+}
+
+int32 FTeamSpatialHash::CountInBox(TConstArrayView<int32> TeamIds, const FBox& Box) const
+{
+	auto Count{ 0 };
+
+	for (const auto& TeamId : TeamIds)
+	{
+		if (!FTeamTrackingTable::IsValidTeamId(TeamId))
+		{
+			continue;
+		}
+
+		ForEachInBox(static_cast<uint8>(TeamId), Box, [&Count](const FElement&)
+		{
+			++Count;
+		});
+	}
+
+	return Count;
+}
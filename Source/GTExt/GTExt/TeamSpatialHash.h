@@ -0,0 +1,184 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GenericTeamAgentInterface.h"
+
+class AActor;
+
+
+/**
+ * Team partitioned spatial hash grid of team members in the world
+ *
+ * Tips:
+ *	Each team has its own grid of cells on the XY plane, so queries select the teams first
+ *	and only test the distance of members of those teams in the cells around the query
+ */
+class GTEXT_API FTeamSpatialHash
+{
+public:
+	explicit FTeamSpatialHash(float InCellSize = DefaultCellSize);
+
+	//
+	// Number of team IDs that can be represented by FGenericTeamId
+	//
+	static constexpr int32 MaxTeams{ 256 };
+
+	//
+	// Default length of the side of a cell
+	//
+	static constexpr float DefaultCellSize{ 2000.0f };
+
+	/**
+	 * Element tracked by the spatial hash
+	 */
+	struct FElement
+	{
+	public:
+		AActor* Actor{ nullptr };
+
+		FVector Location{ FVector::ZeroVector };
+
+		FIntPoint Cell{ FIntPoint::ZeroValue };
+
+		int32 IndexInCell{ INDEX_NONE };
+
+		uint8 TeamId{ FGenericTeamId::NoTeam.GetId() };
+	};
+
+protected:
+	float CellSize;
+	float InvCellSize;
+
+	TSparseArray<FElement> Elements;
+
+	//
+	// Element IDs in each cell of each team
+	//
+	TMap<FIntPoint, TArray<int32>> TeamCells[MaxTeams];
+
+protected:
+	FORCEINLINE FIntPoint ToCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Location.X * InvCellSize), FMath::FloorToInt32(Location.Y * InvCellSize));
+	}
+
+	void LinkToCell(int32 ElementId);
+	void UnlinkFromCell(int32 ElementId);
+
+public:
+	/**
+	 * Add actor to the spatial hash and returns the ID of the element
+	 */
+	int32 Add(AActor* Actor, FGenericTeamId TeamId, const FVector& Location);
+
+	/**
+	 * Remove element from the spatial hash
+	 */
+	void Remove(int32 ElementId);
+
+	/**
+	 * Update the location of the element
+	 */
+	void Move(int32 ElementId, const FVector& NewLocation);
+
+	/**
+	 * Update the team of the element
+	 */
+	void SetTeam(int32 ElementId, FGenericTeamId NewTeamId);
+
+	/**
+	 * Remove all elements
+	 */
+	void Reset();
+
+	FORCEINLINE float GetCellSize() const { return CellSize; }
+
+public:
+	/**
+	 * Executes the function for each element of the team inside the box
+	 */
+	template<typename FuncType>
+	void ForEachInBox(uint8 TeamId, const FBox& Box, FuncType&& Func) const
+	{
+		const auto& Cells{ TeamCells[TeamId] };
+		if (Cells.IsEmpty())
+		{
+			return;
+		}
+
+		const auto MinCell{ ToCell(Box.Min) };
+		const auto MaxCell{ ToCell(Box.Max) };
+
+		auto VisitCell
+		{
+			[this, &Box, &Func](const TArray<int32>& CellElements)
+			{
+				for (const auto& ElementId : CellElements)
+				{
+					const auto& Element{ Elements[ElementId] };
+					if (Box.IsInsideOrOn(Element.Location))
+					{
+						Func(Element);
+					}
+				}
+			}
+		};
+
+		// Visit only occupied cells when the box covers more cells than the team occupies
+
+		const auto NumBoxCells{ static_cast<int64>(MaxCell.X - MinCell.X + 1) * static_cast<int64>(MaxCell.Y - MinCell.Y + 1) };
+		if (NumBoxCells > Cells.Num())
+		{
+			for (const auto& KVP : Cells)
+			{
+				const auto& Cell{ KVP.Key };
+				if ((Cell.X >= MinCell.X) && (Cell.X <= MaxCell.X) && (Cell.Y >= MinCell.Y) && (Cell.Y <= MaxCell.Y))
+				{
+					VisitCell(KVP.Value);
+				}
+			}
+		}
+		else
+		{
+			for (auto X{ MinCell.X }; X <= MaxCell.X; ++X)
+			{
+				for (auto Y{ MinCell.Y }; Y <= MaxCell.Y; ++Y)
+				{
+					if (const auto* CellElements{ Cells.Find(FIntPoint(X, Y)) })
+					{
+						VisitCell(*CellElements);
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * Executes the function for each element of the team within the radius
+	 */
+	template<typename FuncType>
+	void ForEachInRadius(uint8 TeamId, const FVector& Origin, float Radius, FuncType&& Func) const
+	{
+		const auto RadiusSquared{ FMath::Square(Radius) };
+
+		ForEachInBox(TeamId, FBox(Origin - FVector(Radius), Origin + FVector(Radius)), [&Origin, RadiusSquared, &Func](const FElement& Element)
+		{
+			if (FVector::DistSquared(Element.Location, Origin) <= RadiusSquared)
+			{
+				Func(Element);
+			}
+		});
+	}
+
+	/**
+	 * Returns the nearest actor of the teams within the radius or nullptr if there is none
+	 */
+	AActor* FindNearest(TConstArrayView<int32> TeamIds, const FVector& Origin, float Radius, const AActor* IgnoreActor = nullptr) const;
+
+	/**
+	 * Returns the number of elements of the teams inside the box
+	 */
+	int32 CountInBox(TConstArrayView<int32> TeamIds, const FBox& Box) const;
+
+};
@@ -0,0 +1,108 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamStateSnapshot.h"
+
+#include "GTExtLogs.h"
+
+#include "GameFramework/PlayerState.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "GameplayTagsManager.h"
+
+
+static FArchive& operator<<(FArchive& Ar, FTeamStatOption& Stat)
+{
+	auto TagName{ Stat.Tag.GetTagName() };
+
+	Ar << TagName;
+	Ar << Stat.StackCount;
+	Ar << Stat.MaxStackCount;
+
+	if (Ar.IsLoading())
+	{
+		Stat.Tag = UGameplayTagsManager::Get().RequestGameplayTag(TagName, false);
+	}
+
+	return Ar;
+}
+
+static FArchive& operator<<(FArchive& Ar, FTeamSnapshotEntry& Team)
+{
+	Ar << Team.TeamId;
+	Ar << Team.Stats;
+
+	return Ar;
+}
+
+static FArchive& operator<<(FArchive& Ar, FTeamMemberSnapshotEntry& Member)
+{
+	Ar << Member.MemberKey;
+	Ar << Member.TeamId;
+
+	return Ar;
+}
+
+
+FString FTeamStateSnapshot::MakeMemberKey(const APlayerState* PlayerState)
+{
+	check(PlayerState);
+
+	const auto& UniqueId{ PlayerState->GetUniqueId() };
+
+	return UniqueId.IsValid() ? (TEXT("Id:") + UniqueId.ToString()) : (TEXT("Name:") + PlayerState->GetPlayerName());
+}
+
+void FTeamStateSnapshot::SaveToBytes(TArray<uint8>& OutBytes) const
+{
+	OutBytes.Reset();
+
+	FMemoryWriter Writer(OutBytes);
+	const_cast<FTeamStateSnapshot*>(this)->Serialize(Writer);
+}
+
+bool FTeamStateSnapshot::LoadFromBytes(const TArray<uint8>& Bytes)
+{
+	Reset();
+
+	FMemoryReader Reader(Bytes);
+
+	if (!Serialize(Reader) || Reader.IsError())
+	{
+		Reset();
+		return false;
+	}
+
+	return true;
+}
+
+bool FTeamStateSnapshot::Serialize(FArchive& Ar)
+{
+	auto SavedMagic{ Magic };
+	auto SavedVersion{ Version };
+
+	Ar << SavedMagic;
+	Ar << SavedVersion;
+
+	if ((SavedMagic != Magic) || (SavedVersion != Version))
+	{
+		UE_LOG(LogGameExt_Team, Warning, TEXT("Team state snapshot of unknown format (Magic: %x, Version: %u) was ignored"), SavedMagic, SavedVersion);
+
+		Ar.SetError();
+		return false;
+	}
+
+	Ar << Teams;
+	Ar << Members;
+
+	// Drop the stats whose tags no longer exist
+
+	if (Ar.IsLoading())
+	{
+		for (auto& Team : Teams)
+		{
+			Team.Stats.RemoveAll([](const FTeamStatOption& Stat) { return !Stat.Tag.IsValid(); });
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "TeamGameModeOptionIndex.h"
+
+class APlayerState;
+
+
+/**
+ * Team state of a team stored in the snapshot
+ */
+struct FTeamSnapshotEntry
+{
+public:
+	int32 TeamId{ INDEX_NONE };
+
+	TArray<FTeamStatOption> Stats;
+};
+
+
+/**
+ * Team assignment of a player stored in the snapshot
+ */
+struct FTeamMemberSnapshotEntry
+{
+public:
+	//
+	// Key of the player created by FTeamStateSnapshot::MakeMemberKey()
+	//
+	FString MemberKey;
+
+	int32 TeamId{ INDEX_NONE };
+};
+
+
+/**
+ * Versioned binary snapshot of the team state used to carry teams over map travel
+ *
+ * Tips:
+ *	Players are keyed by their unique net ID, or by their player name if they do not have one
+ */
+struct GTEXT_API FTeamStateSnapshot
+{
+public:
+	FTeamStateSnapshot() {}
+
+	//
+	// Identifier written at the start of the serialized snapshot
+	//
+	static constexpr uint32 Magic{ 0x53544754 };
+
+	//
+	// Version of the serialized format, increase this when the layout changes
+	//
+	static constexpr uint32 Version{ 1 };
+
+public:
+	TArray<FTeamSnapshotEntry> Teams;
+
+	TArray<FTeamMemberSnapshotEntry> Members;
+
+public:
+	/**
+	 * Returns the key used to store the team assignment of the player
+	 */
+	static FString MakeMemberKey(const APlayerState* PlayerState);
+
+	/**
+	 * Write the snapshot into the bytes
+	 */
+	void SaveToBytes(TArray<uint8>& OutBytes) const;
+
+	/**
+	 * Read the snapshot from the bytes, returns false if the bytes are invalid or of an unknown version
+	 */
+	bool LoadFromBytes(const TArray<uint8>& Bytes);
+
+	bool IsEmpty() const { return Teams.IsEmpty() && Members.IsEmpty(); }
+
+	void Reset()
+	{
+		Teams.Reset();
+		Members.Reset();
+	}
+
+protected:
+	bool Serialize(FArchive& Ar);
+
+};
@@ -0,0 +1,126 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamStateSnapshotSubsystem.h"
+
+#include "TeamManagerSubsystem.h"
+#include "GTExtLogs.h"
+
+#include "Engine/Engine.h"
+#include "Misc/PackageName.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamStateSnapshotSubsystem)
+
+
+void UTeamStateSnapshotSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	FWorldDelegates::OnSeamlessTravelStart.AddUObject(this, &ThisClass::HandleSeamlessTravelStart);
+	FWorldDelegates::OnPostWorldInitialization.AddUObject(this, &ThisClass::HandlePostWorldInitialization);
+}
+
+void UTeamStateSnapshotSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnSeamlessTravelStart.RemoveAll(this);
+	FWorldDelegates::OnPostWorldInitialization.RemoveAll(this);
+
+	ClearTeamState();
+
+	Super::Deinitialize();
+}
+
+
+void UTeamStateSnapshotSubsystem::HandleSeamlessTravelStart(UWorld* World, const FString& LevelName)
+{
+	if (World && (World->GetGameInstance() == GetGameInstance()) && (World->GetNetMode() != NM_Client))
+	{
+		if (CaptureTeamState(World))
+		{
+			// Only the destination may restore it, not the transition map on the way
+
+			FString MapName;
+			if (!LevelName.Split(TEXT("?"), &MapName, nullptr))
+			{
+				MapName = LevelName;
+			}
+
+			TargetMapName = UWorld::RemovePIEPrefix(FPackageName::GetShortName(MapName));
+		}
+	}
+}
+
+void UTeamStateSnapshotSubsystem::HandlePostWorldInitialization(UWorld* World, const UWorld::InitializationValues IVS)
+{
+	if (SnapshotBytes.IsEmpty() || TargetMapName.IsEmpty() || !World || !World->IsGameWorld() || (World->GetGameInstance() != GetGameInstance()))
+	{
+		return;
+	}
+
+	if (GetShortMapName(World).Equals(TargetMapName))
+	{
+		bTargetWorldInitialized = true;
+	}
+
+	// The destination has been left without restoring the snapshot (e.g., it had no team manager)
+
+	else if (bTargetWorldInitialized)
+	{
+		UE_LOG(LogGameExt_Team, Log, TEXT("Discarded team state snapshot for %s that was not restored"), *TargetMapName);
+
+		ClearTeamState();
+	}
+}
+
+FString UTeamStateSnapshotSubsystem::GetShortMapName(const UWorld* World)
+{
+	return UWorld::RemovePIEPrefix(FPackageName::GetShortName(World->GetOutermost()->GetName()));
+}
+
+
+bool UTeamStateSnapshotSubsystem::CaptureTeamState(const UObject* WorldContextObject)
+{
+	auto* World{ GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) };
+	auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(World) };
+	if (!TMS)
+	{
+		return false;
+	}
+
+	FTeamStateSnapshot Snapshot;
+	TMS->CaptureTeamStateSnapshot(Snapshot);
+	Snapshot.SaveToBytes(SnapshotBytes);
+
+	TargetMapName.Reset();
+	bTargetWorldInitialized = false;
+
+	UE_LOG(LogGameExt_Team, Log, TEXT("Captured team state snapshot (Teams: %d, Members: %d, Bytes: %d)"), 
+		Snapshot.Teams.Num(), Snapshot.Members.Num(), SnapshotBytes.Num());
+
+	return true;
+}
+
+void UTeamStateSnapshotSubsystem::ClearTeamState()
+{
+	SnapshotBytes.Empty();
+	TargetMapName.Reset();
+	bTargetWorldInitialized = false;
+}
+
+bool UTeamStateSnapshotSubsystem::ConsumeTeamState(const UWorld* World, FTeamStateSnapshot& OutSnapshot)
+{
+	if (SnapshotBytes.IsEmpty())
+	{
+		return false;
+	}
+
+	if (!TargetMapName.IsEmpty() && (!World || !GetShortMapName(World).Equals(TargetMapName)))
+	{
+		return false;
+	}
+
+	const auto bResult{ OutSnapshot.LoadFromBytes(SnapshotBytes) };
+
+	ClearTeamState();
+
+	return bResult;
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/World.h"
+
+#include "TeamStateSnapshot.h"
+
+#include "TeamStateSnapshotSubsystem.generated.h"
+
+
+
+/**
+ * Game instance level store of the team state that survives map travel
+ * 
+ * Tips:
+ *	The team state is captured automatically when seamless travel starts on the server,
+ *	and restored by the team manager of the destination world instead of the game mode options.
+ *	A state captured for a travel is discarded if a world other than its destination is loaded after the destination
+ */
+UCLASS()
+class GTEXT_API UTeamStateSnapshotSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	UTeamStateSnapshotSubsystem() {}
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+protected:
+	//
+	// Serialized snapshot waiting to be restored
+	//
+	TArray<uint8> SnapshotBytes;
+
+	//
+	// Short name of the map the snapshot was captured for, or empty if it can be restored by any world
+	//
+	FString TargetMapName;
+
+	//
+	// Whether the world of the target map has been initialized since the capture
+	//
+	bool bTargetWorldInitialized{ false };
+
+protected:
+	void HandleSeamlessTravelStart(UWorld* World, const FString& LevelName);
+	void HandlePostWorldInitialization(UWorld* World, const UWorld::InitializationValues IVS);
+
+	static FString GetShortMapName(const UWorld* World);
+
+public:
+	/**
+	 * Capture the team state of the world to be restored after the next map travel
+	 * 
+	 * Note:
+	 *	This function can only be called on the authority
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Teams", meta = (WorldContext = "WorldContextObject"))
+	bool CaptureTeamState(const UObject* WorldContextObject);
+
+	/**
+	 * Discard the captured team state
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Teams")
+	void ClearTeamState();
+
+	/**
+	 * Returns true if there is a captured team state waiting to be restored
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Teams")
+	bool HasTeamState() const { return !SnapshotBytes.IsEmpty(); }
+
+	/**
+	 * Take the captured team state out of the store if it was captured for the world
+	 */
+	bool ConsumeTeamState(const UWorld* World, FTeamStateSnapshot& OutSnapshot);
+
+};
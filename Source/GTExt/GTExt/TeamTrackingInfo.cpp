@@ -18,14 +18,7 @@ void FTeamTrackingInfo::SetTeamInfo(ATeamInfoBase* Info)
 		ensure((PublicInfo == nullptr) || (PublicInfo == NewPublicInfo));
 
 		PublicInfo = NewPublicInfo;
-
-		auto OldDisplayData{ DisplayData };
 		DisplayData = NewPublicInfo->GetTeamDisplayData();
-
-		if (OldDisplayData != DisplayData)
-		{
-			OnTeamDisplayDataChanged.Broadcast(DisplayData);
-		}
 	}
 
 	// If it is Private Info
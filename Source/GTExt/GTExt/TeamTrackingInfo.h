@@ -36,9 +36,6 @@ public:
 	UPROPERTY()
 	TObjectPtr<UTeamDisplayData> DisplayData{ nullptr };
 
-	UPROPERTY()
-	FTeamDisplayDataChangedDelegate OnTeamDisplayDataChanged;
-
 public:
 	void SetTeamInfo(ATeamInfoBase* Info);
 	void RemoveTeamInfo(ATeamInfoBase* Info);
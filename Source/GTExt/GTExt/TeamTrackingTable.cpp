@@ -0,0 +1,38 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamTrackingTable.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(TeamTrackingTable)
+
+
+int32 FTeamTrackingTable::Num() const
+{
+	auto Count{ 0 };
+
+	for (const auto& Bits : OccupancyBits)
+	{
+		Count += static_cast<int32>(FMath::CountBits(Bits));
+	}
+
+	return Count;
+}
+
+void FTeamTrackingTable::Reset()
+{
+	ForEachTeam([this](int32 TeamId, const FTeamTrackingInfo&)
+	{
+		Entries[TeamId] = FTeamTrackingInfo();
+	});
+
+	FMemory::Memzero(OccupancyBits);
+}
+
+void FTeamTrackingTable::GetTeamIds(TArray<int32>& OutTeamIds) const
+{
+	OutTeamIds.Reset(Num());
+
+	ForEachTeam([&OutTeamIds](int32 TeamId, const FTeamTrackingInfo&)
+	{
+		OutTeamIds.Add(TeamId);
+	});
+}
@@ -0,0 +1,102 @@
+// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "TeamTrackingInfo.h"
+
+#include "TeamTrackingTable.generated.h"
+
+
+/**
+ * Fixed capacity table of team tracking information indexed directly by team ID
+ *
+ * Tips:
+ *	Team IDs are bounded by FGenericTeamId, so every team has a dedicated slot.
+ *	Used slots are tracked by an occupancy bitmask, which lets iteration visit teams in ascending ID order without hashing
+ */
+USTRUCT()
+struct GTEXT_API FTeamTrackingTable
+{
+	GENERATED_BODY()
+public:
+	FTeamTrackingTable() {}
+
+	//
+	// Number of team IDs that can be represented by FGenericTeamId
+	//
+	static constexpr int32 MaxTeams{ 256 };
+
+protected:
+	static constexpr int32 NumOccupancyWords{ MaxTeams / 64 };
+
+	UPROPERTY()
+	FTeamTrackingInfo Entries[256];
+
+	uint64 OccupancyBits[NumOccupancyWords]{ 0 };
+
+public:
+	static FORCEINLINE bool IsValidTeamId(int32 TeamId) { return (TeamId >= 0) && (TeamId < MaxTeams); }
+
+	FORCEINLINE bool Contains(int32 TeamId) const
+	{
+		return IsValidTeamId(TeamId) && ((OccupancyBits[TeamId >> 6] & (1ull << (TeamId & 63))) != 0);
+	}
+
+	FORCEINLINE FTeamTrackingInfo* Find(int32 TeamId)
+	{
+		return Contains(TeamId) ? &Entries[TeamId] : nullptr;
+	}
+
+	FORCEINLINE const FTeamTrackingInfo* Find(int32 TeamId) const
+	{
+		return Contains(TeamId) ? &Entries[TeamId] : nullptr;
+	}
+
+	FORCEINLINE FTeamTrackingInfo& FindChecked(int32 TeamId)
+	{
+		check(Contains(TeamId));
+		return Entries[TeamId];
+	}
+
+	FORCEINLINE FTeamTrackingInfo& FindOrAdd(int32 TeamId)
+	{
+		check(IsValidTeamId(TeamId));
+		OccupancyBits[TeamId >> 6] |= (1ull << (TeamId & 63));
+		return Entries[TeamId];
+	}
+
+	/**
+	 * Returns the number of teams in the table
+	 */
+	int32 Num() const;
+
+	/**
+	 * Remove all teams from the table
+	 */
+	void Reset();
+
+	/**
+	 * Output the IDs of all teams in ascending order
+	 */
+	void GetTeamIds(TArray<int32>& OutTeamIds) const;
+
+	/**
+	 * Executes the function for each team in ascending ID order
+	 */
+	template<typename FuncType>
+	void ForEachTeam(FuncType&& Func) const
+	{
+		for (auto WordIndex{ 0 }; WordIndex < NumOccupancyWords; ++WordIndex)
+		{
+			auto Bits{ OccupancyBits[WordIndex] };
+			while (Bits != 0)
+			{
+				const auto TeamId{ (WordIndex << 6) + static_cast<int32>(FMath::CountTrailingZeros64(Bits)) };
+				Bits &= (Bits - 1);
+
+				Func(TeamId, Entries[TeamId]);
+			}
+		}
+	}
+
+};
@@ -0,0 +1,399 @@
+// Copyright (C) 2024 owoDra
+
+#include "TeamTrackingTable.h"
+#include "TeamManagerSubsystem.h"
+#include "TeamMemberComponent.h"
+#include "Assign/TeamAssign_SkillBalanced.h"
+#include "TeamDisplayData.h"
+#include "GTExtLogs.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/SkeletalMesh.h"
+#include "Materials/MaterialInstanceDynamic.h"
+
+
+#if !UE_BUILD_SHIPPING
+
+namespace GTExtBenchmarks
+{
+	/**
+	 * Returns the elapsed milliseconds of executing the function the specified number of times
+	 */
+	template<typename FuncType>
+	static double MeasureMilliseconds(int32 Iterations, FuncType&& Func)
+	{
+		const auto StartCycles{ FPlatformTime::Cycles64() };
+
+		for (auto Iteration{ 0 }; Iteration < Iterations; ++Iteration)
+		{
+			Func(Iteration);
+		}
+
+		return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	}
+
+	/**
+	 * Compare the lookup and sorted iteration cost of FTeamTrackingTable against TMap<int32, FTeamTrackingInfo>
+	 *
+	 * Usage: GTExt.Benchmark.TeamTable [NumTeams] [Iterations]
+	 */
+	static void BenchmarkTeamTable(const TArray<FString>& Args)
+	{
+		const auto NumTeams{ FMath::Clamp(Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 16, 1, FTeamTrackingTable::MaxTeams - 1) };
+		const auto Iterations{ FMath::Max(Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 1000000, 1) };
+
+		TMap<int32, FTeamTrackingInfo> TeamMap;
+		auto TeamTable{ MakeUnique<FTeamTrackingTable>() };
+
+		for (auto TeamId{ NumTeams - 1 }; TeamId >= 0; --TeamId)
+		{
+			TeamMap.Add(TeamId);
+			TeamTable->FindOrAdd(TeamId);
+		}
+
+		// Lookups
+
+		auto MapHits{ 0 };
+		const auto MapLookupMs{ MeasureMilliseconds(Iterations, [&](int32 Iteration)
+		{
+			MapHits += TeamMap.Contains(Iteration % (NumTeams + 1)) ? 1 : 0;
+		}) };
+
+		auto TableHits{ 0 };
+		const auto TableLookupMs{ MeasureMilliseconds(Iterations, [&](int32 Iteration)
+		{
+			TableHits += TeamTable->Contains(Iteration % (NumTeams + 1)) ? 1 : 0;
+		}) };
+
+		// Sorted iteration
+
+		const auto SortedIterations{ FMath::Max(Iterations / NumTeams, 1) };
+		TArray<int32> TeamIds;
+
+		const auto MapIterateMs{ MeasureMilliseconds(SortedIterations, [&](int32)
+		{
+			TeamMap.GenerateKeyArray(TeamIds);
+			TeamIds.Sort();
+		}) };
+
+		const auto TableIterateMs{ MeasureMilliseconds(SortedIterations, [&](int32)
+		{
+			TeamTable->GetTeamIds(TeamIds);
+		}) };
+
+		ensureMsgf(MapHits == TableHits, TEXT("Team table benchmark: TMap found %d teams but the table found %d"), MapHits, TableHits);
+
+		UE_LOG(LogGameExt_Team, Display, TEXT("Team table benchmark (Teams: %d, Iterations: %d)"), NumTeams, Iterations);
+		UE_LOG(LogGameExt_Team, Display, TEXT("| Lookup:       TMap %.3f ms, Table %.3f ms"), MapLookupMs, TableLookupMs);
+		UE_LOG(LogGameExt_Team, Display, TEXT("| Sorted IDs:   TMap %.3f ms, Table %.3f ms (%d iterations)"), MapIterateMs, TableIterateMs, SortedIterations);
+	}
+
+	static FAutoConsoleCommand BenchmarkTeamTableCommand(
+		TEXT("GTExt.Benchmark.TeamTable"),
+		TEXT("Compare the dense team table against a hashed team map. Usage: GTExt.Benchmark.TeamTable [NumTeams] [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkTeamTable));
+
+	/**
+	 * Compare calling CanCauseDamage per target against a single CanCauseDamageBatch call
+	 *
+	 * Usage: GTExt.Benchmark.CanCauseDamage [NumTargets] [NumTeams] [Iterations]
+	 */
+	static void BenchmarkCanCauseDamage(const TArray<FString>& Args, UWorld* World)
+	{
+		auto* TMS{ UWorld::GetSubsystem<UTeamManagerSubsystem>(World) };
+		if (!TMS)
+		{
+			UE_LOG(LogGameExt_Team, Warning, TEXT("GTExt.Benchmark.CanCauseDamage requires a world with UTeamManagerSubsystem"));
+			return;
+		}
+
+		const auto NumTargets{ FMath::Max(Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 10000, 1) };
+		const auto NumTeams{ FMath::Clamp(Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 4, 1, 254) };
+		const auto Iterations{ FMath::Max(Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : 100, 1) };
+
+		// Spawn temporary team members
+
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+
+		TArray<AActor*> Actors;
+		Actors.Reserve(NumTargets + 1);
+
+		for (auto Index{ 0 }; Index <= NumTargets; ++Index)
+		{
+			auto* Actor{ World->SpawnActor<AActor>(SpawnInfo) };
+
+			auto* TMC{ NewObject<UTeamMemberComponent>(Actor) };
+			TMC->RegisterComponent();
+			TMC->SetGenericTeamId(FGenericTeamId(static_cast<uint8>(Index % NumTeams)));
+
+			Actors.Add(Actor);
+		}
+
+		const auto* Instigator{ Actors[0] };
+		const TArrayView<const AActor* const> Targets(Actors.GetData() + 1, NumTargets);
+
+		// Per target
+
+		auto PerTargetCount{ 0 };
+		const auto PerTargetMs{ MeasureMilliseconds(Iterations, [&](int32)
+		{
+			PerTargetCount = 0;
+
+			for (const auto* Target : Targets)
+			{
+				PerTargetCount += TMS->CanCauseDamage(Instigator, Target) ? 1 : 0;
+			}
+		}) };
+
+		// Batch
+
+		TBitArray<> CanDamage;
+		const auto BatchMs{ MeasureMilliseconds(Iterations, [&](int32)
+		{
+			TMS->CanCauseDamageBatch(Instigator, Targets, CanDamage);
+		}) };
+
+		ensureMsgf(PerTargetCount == CanDamage.CountSetBits(), TEXT("CanCauseDamage benchmark: per target found %d damageable targets but the batch found %d"), PerTargetCount, CanDamage.CountSetBits());
+
+		UE_LOG(LogGameExt_Team, Display, TEXT("CanCauseDamage benchmark (Targets: %d, Teams: %d, Damageable: %d, Iterations: %d)"), NumTargets, NumTeams, PerTargetCount, Iterations);
+		UE_LOG(LogGameExt_Team, Display, TEXT("| Per target: %.4f ms/call, Batch: %.4f ms/call"), PerTargetMs / Iterations, BatchMs / Iterations);
+
+		for (auto* Actor : Actors)
+		{
+			Actor->Destroy();
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCanCauseDamageCommand(
+		TEXT("GTExt.Benchmark.CanCauseDamage"),
+		TEXT("Compare per target CanCauseDamage calls against CanCauseDamageBatch. Usage: GTExt.Benchmark.CanCauseDamage [NumTargets] [NumTeams] [Iterations]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkCanCauseDamage));
+
+	/**
+	 * Measure the skill balanced partition and compare its balance against assigning players in join order
+	 *
+	 * Usage: GTExt.Benchmark.SkillPartition [NumPlayers] [NumTeams] [Iterations]
+	 */
+	static void BenchmarkSkillPartition(const TArray<FString>& Args)
+	{
+		const auto NumPlayers{ FMath::Max(Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 128, 1) };
+		const auto NumTeams{ FMath::Clamp(Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 2, 1, 255) };
+		const auto Iterations{ FMath::Max(Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : 100, 1) };
+
+		// Ratings roughly distributed like a matchmaking rating
+
+		FRandomStream RandomStream(NumPlayers * 31 + NumTeams);
+
+		TArray<double> Ratings;
+		Ratings.SetNumUninitialized(NumPlayers);
+
+		for (auto& PlayerRating : Ratings)
+		{
+			PlayerRating = FMath::Max(0.0, 1500.0 + (RandomStream.FRandRange(-1.0f, 1.0f) + RandomStream.FRandRange(-1.0f, 1.0f)) * 400.0);
+		}
+
+		auto MakeBuckets
+		{
+			[NumTeams](TArray<FTeamRatingBucket>& OutBuckets)
+			{
+				OutBuckets.Reset(NumTeams);
+
+				for (auto TeamId{ 0 }; TeamId < NumTeams; ++TeamId)
+				{
+					OutBuckets.Emplace(TeamId);
+				}
+			}
+		};
+
+		// Join order (round robin by headcount)
+
+		TArray<FTeamRatingBucket> JoinOrderBuckets;
+		MakeBuckets(JoinOrderBuckets);
+
+		for (auto Index{ 0 }; Index < NumPlayers; ++Index)
+		{
+			auto& Bucket{ JoinOrderBuckets[Index % NumTeams] };
+			Bucket.Count++;
+			Bucket.RatingSum += Ratings[Index];
+		}
+
+		// Skill balanced
+
+		TArray<FTeamRatingBucket> Buckets;
+		TArray<int32> BucketIndices;
+
+		const auto PartitionMs{ MeasureMilliseconds(Iterations, [&](int32)
+		{
+			MakeBuckets(Buckets);
+			UTeamAssign_SkillBalanced::PartitionByRating(Ratings, Buckets, BucketIndices, 16);
+		}) };
+
+		UE_LOG(LogGameExt_Team, Display, TEXT("Skill partition benchmark (Players: %d, Teams: %d, Iterations: %d)"), NumPlayers, NumTeams, Iterations);
+		UE_LOG(LogGameExt_Team, Display, TEXT("| Partition:  %.4f ms per assignment"), PartitionMs / Iterations);
+		UE_LOG(LogGameExt_Team, Display, TEXT("| Join order: %s"), *UTeamAssign_SkillBalanced::ComputeBalanceMetrics(JoinOrderBuckets).ToString());
+		UE_LOG(LogGameExt_Team, Display, TEXT("| Balanced:   %s"), *UTeamAssign_SkillBalanced::ComputeBalanceMetrics(Buckets).ToString());
+	}
+
+	static FAutoConsoleCommand BenchmarkSkillPartitionCommand(
+		TEXT("GTExt.Benchmark.SkillPartition"),
+		TEXT("Measure the skill balanced team partition and its balance quality. Usage: GTExt.Benchmark.SkillPartition [NumPlayers] [NumTeams] [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkSkillPartition));
+
+	/**
+	 * Compare applying team display data per parameter on all materials against applying cached parameter blocks per slot
+	 *
+	 * Usage: GTExt.Benchmark.TeamDisplayData <DisplayDataPath> <MeshPath> [NumComponents] [Iterations]
+	 */
+	static void BenchmarkTeamDisplayData(const TArray<FString>& Args, UWorld* World)
+	{
+		const auto* DisplayData{ Args.IsValidIndex(0) ? LoadObject<UTeamDisplayData>(nullptr, *Args[0]) : nullptr };
+		auto* Mesh{ Args.IsValidIndex(1) ? LoadObject<UObject>(nullptr, *Args[1]) : nullptr };
+
+		if (!World || !DisplayData || (!Cast<UStaticMesh>(Mesh) && !Cast<USkeletalMesh>(Mesh)))
+		{
+			UE_LOG(LogGameExt_Team, Warning, TEXT("Usage: GTExt.Benchmark.TeamDisplayData <DisplayDataPath> <StaticMeshOrSkeletalMeshPath> [NumComponents] [Iterations]"));
+			return;
+		}
+
+		const auto NumComponents{ FMath::Max(Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : 100, 1) };
+		const auto Iterations{ FMath::Max(Args.IsValidIndex(3) ? FCString::Atoi(*Args[3]) : 10, 1) };
+
+		// Spawn a temporary actor with mesh components
+
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+
+		auto* Actor{ World->SpawnActor<AActor>(SpawnInfo) };
+
+		TArray<UMeshComponent*> MeshComponents;
+		MeshComponents.Reserve(NumComponents);
+
+		for (auto Index{ 0 }; Index < NumComponents; ++Index)
+		{
+			UMeshComponent* MeshComponent{ nullptr };
+
+			if (auto* StaticMesh{ Cast<UStaticMesh>(Mesh) })
+			{
+				auto* StaticMeshComponent{ NewObject<UStaticMeshComponent>(Actor) };
+				StaticMeshComponent->SetStaticMesh(StaticMesh);
+				MeshComponent = StaticMeshComponent;
+			}
+			else
+			{
+				auto* SkeletalMeshComponent{ NewObject<USkeletalMeshComponent>(Actor) };
+				SkeletalMeshComponent->SetSkeletalMesh(Cast<USkeletalMesh>(Mesh));
+				MeshComponent = SkeletalMeshComponent;
+			}
+
+			MeshComponent->RegisterComponent();
+			MeshComponents.Add(MeshComponent);
+		}
+
+		auto ResetMaterials
+		{
+			[&MeshComponents]()
+			{
+				for (auto* MeshComponent : MeshComponents)
+				{
+					MeshComponent->EmptyOverrideMaterials();
+				}
+			}
+		};
+
+		// Per parameter on all materials, which creates dynamic materials for every slot
+
+		auto ApplyPerParameter
+		{
+			[DisplayData](UMeshComponent* MeshComponent)
+			{
+				for (const auto& KVP : DisplayData->GetScalarParameters())
+				{
+					MeshComponent->SetScalarParameterValueOnMaterials(KVP.Key, KVP.Value);
+				}
+
+				for (const auto& KVP : DisplayData->GetColorParameters())
+				{
+					MeshComponent->SetVectorParameterValueOnMaterials(KVP.Key, FVector(KVP.Value));
+				}
+
+				const auto MaterialInterfaces{ MeshComponent->GetMaterials() };
+				for (auto MaterialIndex{ 0 }; MaterialIndex < MaterialInterfaces.Num(); ++MaterialIndex)
+				{
+					if (const auto& MaterialInterface{ MaterialInterfaces[MaterialIndex] })
+					{
+						auto* DynamicMaterial{ Cast<UMaterialInstanceDynamic>(MaterialInterface) };
+
+						if (!DynamicMaterial)
+						{
+							DynamicMaterial = MeshComponent->CreateAndSetMaterialInstanceDynamic(MaterialIndex);
+						}
+
+						for (const auto& KVP : DisplayData->GetTextureParameters())
+						{
+							DynamicMaterial->SetTextureParameterValue(KVP.Key, KVP.Value);
+						}
+					}
+				}
+			}
+		};
+
+		ResetMaterials();
+		const auto PerParameterFirstMs{ MeasureMilliseconds(1, [&](int32)
+		{
+			for (auto* MeshComponent : MeshComponents)
+			{
+				ApplyPerParameter(MeshComponent);
+			}
+		}) };
+
+		const auto PerParameterMs{ MeasureMilliseconds(Iterations, [&](int32)
+		{
+			for (auto* MeshComponent : MeshComponents)
+			{
+				ApplyPerParameter(MeshComponent);
+			}
+		}) };
+
+		// Cached parameter blocks
+
+		ResetMaterials();
+		DisplayData->ClearParameterBlockCache();
+
+		const auto BlockFirstMs{ MeasureMilliseconds(1, [&](int32)
+		{
+			for (auto* MeshComponent : MeshComponents)
+			{
+				DisplayData->ApplyToMeshComponent(MeshComponent);
+			}
+		}) };
+
+		const auto BlockMs{ MeasureMilliseconds(Iterations, [&](int32)
+		{
+			for (auto* MeshComponent : MeshComponents)
+			{
+				DisplayData->ApplyToMeshComponent(MeshComponent);
+			}
+		}) };
+
+		UE_LOG(LogGameExt_Team, Display, TEXT("Team display data benchmark (Components: %d, Slots: %d, Iterations: %d)"), NumComponents, MeshComponents[0]->GetNumMaterials(), Iterations);
+		UE_LOG(LogGameExt_Team, Display, TEXT("| First apply:  Per parameter %.3f ms, Block %.3f ms"), PerParameterFirstMs, BlockFirstMs);
+		UE_LOG(LogGameExt_Team, Display, TEXT("| Reapply:      Per parameter %.3f ms, Block %.3f ms (per iteration)"), PerParameterMs / Iterations, BlockMs / Iterations);
+
+		Actor->Destroy();
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkTeamDisplayDataCommand(
+		TEXT("GTExt.Benchmark.TeamDisplayData"),
+		TEXT("Compare per parameter application of team display data against cached parameter blocks. Usage: GTExt.Benchmark.TeamDisplayData <DisplayDataPath> <MeshPath> [NumComponents] [Iterations]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkTeamDisplayData));
+}
+
+#endif